@@ -1,23 +1,527 @@
 #pragma once
 
+#include "../container.h"
+#include "../eigen.h"
+#include "../grppiex.h"
+#include "ei_searchsorted.h"
+#include "ei_stats.h"
 #include <Eigen/Core>
 
 namespace alg {
 
+namespace internal {
+
+// whether the resampling is along the row of vector type Derived. The 1x1
+// type is taken as a column vector
+template <typename Derived>
+inline constexpr bool is_row_vector =
+    Derived::IsVectorAtCompileTime && Derived::ColsAtCompileTime != 1;
+
+// the axis of downsample and rebin, which for vectors is along the length
+template <typename Derived, Axis axis>
+inline constexpr Axis resample_axis =
+    !Derived::IsVectorAtCompileTime
+        ? axis
+        : (is_row_vector<Derived> ? Axis::Rowwise : Axis::Colwise);
+
+// the resampled type, of which the size along the vector and the axis is
+// dynamic
+template <typename Derived>
+using resample_output_t = Eigen::Matrix<
+    typename Derived::Scalar, is_row_vector<Derived> ? 1 : Eigen::Dynamic,
+    Derived::IsVectorAtCompileTime && !is_row_vector<Derived>
+        ? 1
+        : Eigen::Dynamic>;
+
+} // namespace internal
+
 template <bool conserve_sum = true, typename Derived>
 auto upsample(const Eigen::DenseBase<Derived> &vector, Eigen::Index n) {
     static_assert(std::is_floating_point_v<typename Derived::Scalar>,
                   "EXPECT FLOATING POINT");
     static_assert(Derived::IsVectorAtCompileTime, "EXPECT VECTOR");
     auto output_size = vector.size() * n;
-    typename Derived::PlainObject output(output_size);
+    internal::resample_output_t<Derived> output(output_size);
     for (Eigen::Index i = 0; i < vector.size(); ++i) {
         if constexpr (conserve_sum) {
-            output.segment(i, n).array() = vector.coeff(i) / n;
+            output.segment(i * n, n).setConstant(vector.coeff(i) / n);
         } else {
-            output.segment(i, n).array() = vector.coeff(i);
+            output.segment(i * n, n).setConstant(vector.coeff(i));
+        }
+    }
+    return output;
+}
+
+namespace internal {
+
+// pointer to the data of vector x, which are copied to buffer unless they
+// are contiguous in memory
+template <typename Derived, typename Buffer>
+const typename Derived::Scalar *
+contiguous_data(const Eigen::DenseBase<Derived> &x, Buffer &buffer) {
+    const auto &d = x.derived();
+    if constexpr (bool(Derived::Flags & Eigen::DirectAccessBit)) {
+        if (d.innerStride() == 1) {
+            return d.data();
         }
     }
+    if constexpr (Derived::ColsAtCompileTime == 1) {
+        buffer = d;
+    } else {
+        buffer = d.transpose();
+    }
+    return buffer.data();
+}
+
+// downsample the contiguous data p[0, size) by n
+template <bool conserve_sum, typename Scalar, typename Output>
+void downsample_contiguous(const Scalar *p, Eigen::Index size, Eigen::Index n,
+                           Output &&output) {
+    using Eigen::Dynamic;
+    using Eigen::Index;
+    using Eigen::InnerStride;
+    using Vector = Eigen::Matrix<Scalar, Dynamic, 1>;
+    using Matrix = Eigen::Matrix<Scalar, Dynamic, Dynamic>;
+    const auto n_full = size / n;
+    if (n <= 4) {
+        // for small factors, the horizontal sums do not vectorize, so the
+        // strided rows of the blocks are accumulated instead, in chunks that
+        // stay in the cache
+        constexpr Index chunk_size = 512;
+        for (Index i = 0; i < n_full; i += chunk_size) {
+            auto m = std::min(chunk_size, n_full - i);
+            auto out = output.segment(i, m);
+            const auto *pi = p + i * n;
+            out = Eigen::Map<const Vector, 0, InnerStride<>>(pi, m,
+                                                             InnerStride<>(n));
+            for (Index k = 1; k < n; ++k) {
+                out += Eigen::Map<const Vector, 0, InnerStride<>>(
+                    pi + k, m, InnerStride<>(n));
+            }
+        }
+    } else {
+        output.head(n_full) =
+            Eigen::Map<const Matrix>(p, n, n_full).colwise().sum().transpose();
+    }
+    if constexpr (!conserve_sum) {
+        output.head(n_full) /= static_cast<Scalar>(n);
+    }
+    // trailing partial block
+    if (auto rem = size - n_full * n; rem > 0) {
+        auto tail = Eigen::Map<const Vector>(p + n_full * n, rem).sum();
+        if constexpr (!conserve_sum) {
+            tail /= static_cast<Scalar>(rem);
+        }
+        output.coeffRef(n_full) = tail;
+    }
+}
+
+} // namespace internal
+
+/**
+ * @brief Downsample by integer factor \p n.
+ * The blocks of \p n elements are reduced to their sums, or their means if
+ * \p conserve_sum is false. The trailing partial block is reduced to the sum
+ * or mean of the remaining elements.
+ * @tparam axis With \ref Axis::Colwise, each column is downsampled, and with
+ * \ref Axis::Rowwise, each row is. It is ignored for vectors.
+ * @return Vector of the orientation of \p m, or matrix, of dynamic size.
+ * @note Vectors and columns that are expressions or strided are evaluated
+ * to a temporary, one at a time.
+ * @see upsample
+ */
+template <bool conserve_sum = true, Axis axis = Axis::Colwise,
+          typename Derived>
+auto downsample(const Eigen::DenseBase<Derived> &m, Eigen::Index n) {
+    using Scalar = typename Derived::Scalar;
+    static_assert(std::is_floating_point_v<Scalar>, "EXPECT FLOATING POINT");
+    using Eigen::Index;
+    if (n < 1) {
+        throw std::runtime_error(
+            fmt::format("invalid downsample factor {}", n));
+    }
+    using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+    const auto &d = m.derived();
+    internal::resample_output_t<Derived> output;
+    // vectors that are not contiguous are copied to buffer, one at a time
+    Vector buffer;
+    auto downsample_vector = [&](const auto &x, Scalar *out) {
+        internal::downsample_contiguous<conserve_sum>(
+            internal::contiguous_data(x, buffer), x.size(), n,
+            Eigen::Map<Vector>(out, (x.size() + n - 1) / n));
+    };
+    if constexpr (Derived::IsVectorAtCompileTime) {
+        output.resize((d.size() + n - 1) / n);
+        downsample_vector(d, output.data());
+    } else if constexpr (axis == Axis::Colwise) {
+        output.resize((d.rows() + n - 1) / n, d.cols());
+        for (Index j = 0; j < d.cols(); ++j) {
+            downsample_vector(d.col(j), output.col(j).data());
+        }
+    } else {
+        // the columns are added as vectors
+        const auto size = d.cols();
+        output.resize(d.rows(), (size + n - 1) / n);
+        for (Index i = 0; i < output.cols(); ++i) {
+            auto len = std::min(n, size - i * n);
+            output.col(i) = d.middleCols(i * n, len).rowwise().sum();
+            if constexpr (!conserve_sum) {
+                output.col(i) /= static_cast<Scalar>(len);
+            }
+        }
+    }
+    return output;
+}
+
+/**
+ * @brief Resample to \p size bins, of which the width needs not be an
+ * integer number of elements.
+ * Each output bin is the sum of the elements it overlaps, weighted by the
+ * overlapping fraction, or that divided by the bin width if
+ * \p conserve_sum is false. For sizes that divide the input size, this is
+ * the same as \ref downsample.
+ * @tparam axis With \ref Axis::Colwise, each column is rebinned, and with
+ * \ref Axis::Rowwise, each row is. It is ignored for vectors.
+ */
+template <bool conserve_sum = true, Axis axis = Axis::Colwise,
+          typename Derived>
+auto rebin(const Eigen::DenseBase<Derived> &m, Eigen::Index size) {
+    using Scalar = typename Derived::Scalar;
+    static_assert(std::is_floating_point_v<Scalar>, "EXPECT FLOATING POINT");
+    using Eigen::Index;
+    constexpr auto axis_ = internal::resample_axis<Derived, axis>;
+    const auto &d = m.derived();
+    const auto n = axis_ == Axis::Colwise ? d.rows() : d.cols();
+    if (size < 1 || n < 1) {
+        throw std::runtime_error(
+            fmt::format("invalid rebin size {} for data size {}", size, n));
+    }
+    internal::resample_output_t<Derived> output;
+    if constexpr (axis_ == Axis::Colwise) {
+        output.resize(size, d.cols());
+    } else {
+        output.resize(d.rows(), size);
+    }
+    const auto width = static_cast<double>(n) / static_cast<double>(size);
+    for (Index j = 0; j < internal::n_slices<axis_>(d); ++j) {
+        const auto x = internal::slice<axis_>(d, j);
+        for (Index k = 0; k < size; ++k) {
+            const auto a = k * width;
+            const auto b = k + 1 == size ? static_cast<double>(n) : a + width;
+            const auto ia = static_cast<Index>(a);
+            const auto ib = std::min(static_cast<Index>(b), n);
+            Scalar sum;
+            if (ia == ib) {
+                sum = static_cast<Scalar>(b - a) * x.coeff(ia);
+            } else {
+                sum = static_cast<Scalar>(ia + 1 - a) * x.coeff(ia) +
+                      x.segment(ia + 1, ib - ia - 1).sum();
+                if (ib < n) {
+                    sum += static_cast<Scalar>(b - ib) * x.coeff(ib);
+                }
+            }
+            if constexpr (!conserve_sum) {
+                sum /= static_cast<Scalar>(width);
+            }
+            if constexpr (axis_ == Axis::Colwise) {
+                output.coeffRef(k, j) = sum;
+            } else {
+                output.coeffRef(j, k) = sum;
+            }
+        }
+    }
+    return output;
+}
+
+/**
+ * @brief Uniform bins.
+ * The bin index is computed in O(1). The last bin includes the upper edge,
+ * as in numpy.histogram.
+ */
+class UniformBins {
+public:
+    UniformBins(Eigen::Index n, double min, double max)
+        : m_n{n}, m_min{min}, m_max{max}, m_scale{n / (max - min)} {
+        if (n < 1 || !(max > min)) {
+            throw std::runtime_error(fmt::format(
+                "invalid uniform bins n={} range=[{}, {}]", n, min, max));
+        }
+    }
+    /// @brief Returns the number of bins.
+    Eigen::Index size() const { return m_n; }
+    /// @brief Returns the bin edges.
+    Eigen::VectorXd edges() const {
+        return Eigen::VectorXd::LinSpaced(m_n + 1, m_min, m_max);
+    }
+    /// @brief Returns the bin index of \p x, or -1 if out of range or NaN.
+    Eigen::Index index(double x) const {
+        if (!(x >= m_min && x <= m_max)) {
+            return -1;
+        }
+        return std::min(static_cast<Eigen::Index>((x - m_min) * m_scale),
+                        m_n - 1);
+    }
+
+private:
+    Eigen::Index m_n;
+    double m_min;
+    double m_max;
+    double m_scale;
+};
+
+/**
+ * @brief Bins of variable edges.
+ * The bin index is computed by binary search. The last bin includes the
+ * upper edge, as in numpy.histogram.
+ */
+class EdgeBins {
+public:
+    /// @param edges The bin edges, in ascending order.
+    template <typename Derived>
+    EdgeBins(const Eigen::DenseBase<Derived> &edges) : m_edges{edges} {
+        if (m_edges.size() < 2) {
+            throw std::runtime_error(
+                fmt::format("invalid bin edges size {}", m_edges.size()));
+        }
+    }
+    /// @brief Returns the number of bins.
+    Eigen::Index size() const { return m_edges.size() - 1; }
+    /// @brief Returns the bin edges.
+    const Eigen::VectorXd &edges() const { return m_edges; }
+    /// @brief Returns the bin index of \p x, or -1 if out of range or NaN.
+    Eigen::Index index(double x) const {
+        if (!(x >= m_edges.coeff(0) && x <= m_edges.coeff(size()))) {
+            return -1;
+        }
+        return std::min(searchsorted<Side::Right>(m_edges, x) - 1,
+                        size() - 1);
+    }
+
+private:
+    Eigen::VectorXd m_edges;
+};
+
+namespace internal {
+
+// unit weight for unweighted histograms
+struct unit_weight {
+    constexpr double coeff(Eigen::Index) const { return 1.; }
+};
+
+template <typename Bins, typename DerivedX, typename W>
+void histogram_fill(Eigen::VectorXd &counts, const Bins &bins,
+                    const Eigen::DenseBase<DerivedX> &x, const W &weights,
+                    Eigen::Index begin, Eigen::Index end) {
+    const auto &xx = x.derived();
+    for (auto i = begin; i < end; ++i) {
+        auto ix = bins.index(static_cast<double>(xx.coeff(i)));
+        if (ix >= 0) {
+            counts.coeffRef(ix) += weights.coeff(i);
+        }
+    }
+}
+
+template <typename XBins, typename YBins, typename DerivedX,
+          typename DerivedY, typename W>
+void histogram2d_fill(Eigen::MatrixXd &counts, const XBins &xbins,
+                      const YBins &ybins, const Eigen::DenseBase<DerivedX> &x,
+                      const Eigen::DenseBase<DerivedY> &y, const W &weights,
+                      Eigen::Index begin, Eigen::Index end) {
+    const auto &xx = x.derived();
+    const auto &yy = y.derived();
+    for (auto i = begin; i < end; ++i) {
+        auto ix = xbins.index(static_cast<double>(xx.coeff(i)));
+        auto iy = ybins.index(static_cast<double>(yy.coeff(i)));
+        if (ix >= 0 && iy >= 0) {
+            counts.coeffRef(ix, iy) += weights.coeff(i);
+        }
+    }
+}
+
+// map_reduce of the partial histograms of blocks of [0, n)
+// the number of blocks is a few times the threads of ex within the budget,
+// so the partials take bounded memory. The sequential execution fills one
+// histogram
+template <typename T, typename F>
+T reduce_partials(const grppi::dynamic_execution &ex, Eigen::Index n,
+                  const T &zero, F &&fill) {
+    const auto n_threads = grppiex::concurrency(ex);
+    const Eigen::Index n_blocks =
+        n_threads <= 1
+            ? 1
+            : std::min<Eigen::Index>(
+                  4 * grppiex::Budget::instance().limit(n_threads), n);
+    if (n_blocks <= 1) {
+        T counts = zero;
+        fill(counts, 0, n);
+        return counts;
+    }
+    const auto size = (n + n_blocks - 1) / n_blocks;
+    auto blocks = container_utils::views::iota((n + size - 1) / size);
+    return grppi::map_reduce(
+        ex, blocks.begin(), blocks.end(), zero,
+        [&](Eigen::Index i) {
+            T counts = zero;
+            fill(counts, i * size, std::min(n, (i + 1) * size));
+            return counts;
+        },
+        [](const T &lhs, const T &rhs) -> T { return lhs + rhs; });
+}
+
+template <typename DerivedX, typename DerivedY>
+void check_size(const Eigen::DenseBase<DerivedX> &x,
+                const Eigen::DenseBase<DerivedY> &y) {
+    if (y.size() != x.size()) {
+        throw std::runtime_error(fmt::format(
+            "input size {} mismatch data size {}", y.size(), x.size()));
+    }
+}
+
+} // namespace internal
+
+/**
+ * @brief Return histogram of \p data in \p bins.
+ * The values out of the range of the bins and NaNs are skipped.
+ * @param bins The bins, \ref UniformBins or \ref EdgeBins.
+ * @return The counts in the bins.
+ */
+template <typename Bins, typename Derived>
+Eigen::VectorXd histogram(const Bins &bins,
+                          const Eigen::DenseBase<Derived> &data) {
+    Eigen::VectorXd counts = Eigen::VectorXd::Zero(bins.size());
+    internal::histogram_fill(counts, bins, data, internal::unit_weight{}, 0,
+                             data.size());
+    return counts;
+}
+
+/**
+ * @brief Return weighted histogram of \p data in \p bins.
+ * @return The sum of \p weights in the bins.
+ * @see histogram
+ */
+template <typename Bins, typename DerivedX, typename DerivedW>
+Eigen::VectorXd histogram(const Bins &bins,
+                          const Eigen::DenseBase<DerivedX> &data,
+                          const Eigen::DenseBase<DerivedW> &weights) {
+    internal::check_size(data, weights);
+    Eigen::VectorXd counts = Eigen::VectorXd::Zero(bins.size());
+    internal::histogram_fill(counts, bins, data, weights.derived(), 0,
+                             data.size());
+    return counts;
+}
+
+/**
+ * @brief Return histogram of \p data in \p bins, computed in parallel with
+ * \p ex.
+ * The data are split into blocks, of which the partial histograms are
+ * merged.
+ * @see histogram
+ */
+template <typename Bins, typename Derived>
+Eigen::VectorXd histogram(const grppi::dynamic_execution &ex, const Bins &bins,
+                          const Eigen::DenseBase<Derived> &data) {
+    return internal::reduce_partials(
+        ex, data.size(), Eigen::VectorXd::Zero(bins.size()).eval(),
+        [&](auto &counts, auto begin, auto end) {
+            internal::histogram_fill(counts, bins, data,
+                                     internal::unit_weight{}, begin, end);
+        });
+}
+
+/**
+ * @brief Return weighted histogram of \p data in \p bins, computed in
+ * parallel with \p ex.
+ * @see histogram
+ */
+template <typename Bins, typename DerivedX, typename DerivedW>
+Eigen::VectorXd histogram(const grppi::dynamic_execution &ex, const Bins &bins,
+                          const Eigen::DenseBase<DerivedX> &data,
+                          const Eigen::DenseBase<DerivedW> &weights) {
+    internal::check_size(data, weights);
+    return internal::reduce_partials(
+        ex, data.size(), Eigen::VectorXd::Zero(bins.size()).eval(),
+        [&](auto &counts, auto begin, auto end) {
+            internal::histogram_fill(counts, bins, data, weights.derived(),
+                                     begin, end);
+        });
+}
+
+/**
+ * @brief Return 2-d histogram of the points (\p x, \p y) in bins \p xbins
+ * and \p ybins.
+ * @return The counts of shape (xbins.size(), ybins.size()).
+ * @see histogram
+ */
+template <typename XBins, typename YBins, typename DerivedX,
+          typename DerivedY>
+Eigen::MatrixXd histogram2d(const XBins &xbins, const YBins &ybins,
+                            const Eigen::DenseBase<DerivedX> &x,
+                            const Eigen::DenseBase<DerivedY> &y) {
+    internal::check_size(x, y);
+    Eigen::MatrixXd counts = Eigen::MatrixXd::Zero(xbins.size(), ybins.size());
+    internal::histogram2d_fill(counts, xbins, ybins, x, y,
+                               internal::unit_weight{}, 0, x.size());
+    return counts;
+}
+
+/**
+ * @brief Return weighted 2-d histogram.
+ * @see histogram2d
+ */
+template <typename XBins, typename YBins, typename DerivedX,
+          typename DerivedY, typename DerivedW>
+Eigen::MatrixXd histogram2d(const XBins &xbins, const YBins &ybins,
+                            const Eigen::DenseBase<DerivedX> &x,
+                            const Eigen::DenseBase<DerivedY> &y,
+                            const Eigen::DenseBase<DerivedW> &weights) {
+    internal::check_size(x, y);
+    internal::check_size(x, weights);
+    Eigen::MatrixXd counts = Eigen::MatrixXd::Zero(xbins.size(), ybins.size());
+    internal::histogram2d_fill(counts, xbins, ybins, x, y, weights.derived(),
+                               0, x.size());
+    return counts;
+}
+
+/**
+ * @brief Return 2-d histogram, computed in parallel with \p ex.
+ * @see histogram2d
+ */
+template <typename XBins, typename YBins, typename DerivedX,
+          typename DerivedY>
+Eigen::MatrixXd histogram2d(const grppi::dynamic_execution &ex,
+                            const XBins &xbins, const YBins &ybins,
+                            const Eigen::DenseBase<DerivedX> &x,
+                            const Eigen::DenseBase<DerivedY> &y) {
+    internal::check_size(x, y);
+    return internal::reduce_partials(
+        ex, x.size(),
+        Eigen::MatrixXd::Zero(xbins.size(), ybins.size()).eval(),
+        [&](auto &counts, auto begin, auto end) {
+            internal::histogram2d_fill(counts, xbins, ybins, x, y,
+                                       internal::unit_weight{}, begin, end);
+        });
+}
+
+/**
+ * @brief Return weighted 2-d histogram, computed in parallel with \p ex.
+ * @see histogram2d
+ */
+template <typename XBins, typename YBins, typename DerivedX,
+          typename DerivedY, typename DerivedW>
+Eigen::MatrixXd histogram2d(const grppi::dynamic_execution &ex,
+                            const XBins &xbins, const YBins &ybins,
+                            const Eigen::DenseBase<DerivedX> &x,
+                            const Eigen::DenseBase<DerivedY> &y,
+                            const Eigen::DenseBase<DerivedW> &weights) {
+    internal::check_size(x, y);
+    internal::check_size(x, weights);
+    return internal::reduce_partials(
+        ex, x.size(),
+        Eigen::MatrixXd::Zero(xbins.size(), ybins.size()).eval(),
+        [&](auto &counts, auto begin, auto end) {
+            internal::histogram2d_fill(counts, xbins, ybins, x, y,
+                                       weights.derived(), begin, end);
+        });
 }
 
-} // namespace alg
\ No newline at end of file
+} // namespace alg
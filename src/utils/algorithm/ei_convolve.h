@@ -10,24 +10,23 @@ template <BorderMode mode = BorderMode::Nearest, typename Derived>
 auto borderpad1d(const Eigen::DenseBase<Derived> &vector, Eigen::Index size) {
     auto n = vector.size();
     auto n0 = (size - 1) / 2;
-    assert(n > size);
+    assert(n >= size);
     assert(size > 1);
     // make copy
     typename Derived::PlainObject output(n + size - 1);
     output.segment(n0, n) = vector;
-    if (n0 > 0) {
-        if constexpr (mode == BorderMode::Mirror) {
-            // --- n0--- -- n ---------  size - 1 - n0
-            // c   b   | a   bc  d     | c      b          |
-            // 0 n0-1   n0     n0+n-1   n0 + n  n+size-2
-            output.head(n0).reverse() = output.segment(n0 + 1, n0);
-            output.tail(size - 1 - n0).reverse() =
-                output.segment(n0 + n - 1 - (size - 1 - n0), size - 1 - n0);
-        }
-        if constexpr (mode == BorderMode::Nearest) {
-            output.head(n0) = output.coeff(n0);
-            output.tail(size - 1 - n0) = output.coeff(n0 + n - 1);
-        }
+    // the head is empty for size 2, but the tail is not
+    if constexpr (mode == BorderMode::Mirror) {
+        // --- n0--- -- n ---------  size - 1 - n0
+        // c   b   | a   bc  d     | c      b          |
+        // 0 n0-1   n0     n0+n-1   n0 + n  n+size-2
+        output.head(n0).reverse() = output.segment(n0 + 1, n0);
+        output.tail(size - 1 - n0).reverse() =
+            output.segment(n0 + n - 1 - (size - 1 - n0), size - 1 - n0);
+    }
+    if constexpr (mode == BorderMode::Nearest) {
+        output.head(n0).setConstant(output.coeff(n0));
+        output.tail(size - 1 - n0).setConstant(output.coeff(n0 + n - 1));
     }
     return output;
 }
@@ -3,9 +3,11 @@
 #include "../eigen.h"
 #include "../eigeniter.h"
 #include "../grppiex.h"
+#include "../grppiex/telemetry.h"
 #include "../logging.h"
 #include "../meta.h"
-#include <set>
+#include <algorithm>
+#include <utility>
 
 namespace alg {
 
@@ -13,12 +15,38 @@ namespace detect1d {
 
 using Index = Eigen::Index;
 
+namespace internal {
+
+/// @brief Returns the number of bytes allocated by vector \p v.
+template <typename T> std::size_t vector_footprint(const std::vector<T> &v) {
+    return v.capacity() * sizeof(T);
+}
+
+/// @brief Returns the number of bytes allocated by the findfunc results.
+/// Only the feature index vectors are accounted for.
+template <typename R2>
+std::size_t findfunc_results_footprint(const std::vector<R2> &results) {
+    auto size = vector_footprint(results);
+    for (const auto &r : results) {
+        if (r.has_value()) {
+            size += vector_footprint(std::get<0>(r.value()));
+        }
+    }
+    return size;
+}
+
+} // namespace internal
+
 /**
  * @brief Class to store intermediate results of \ref divconqfinder.
  * This is optionally created, populated, and reuturned
  * from the \ref divconqfinder function if the
  * template parameter \p ReturnStateCache is set.
- * @see divconqfinder
+ * The input data and the results are copied.
+ * @note The per-chunk and per-segment results are written concurrently by
+ * the tasks to distinct slots allocated beforehand, so the cache should not
+ * be accessed until \ref divconqfinder returns.
+ * @see DivConqFinderStateCacheRef, divconqfinder
  */
 template <typename F1, typename F2, typename F3, typename R1, typename R2,
           typename R3>
@@ -37,8 +65,258 @@ struct DivConqFinderStateCache {
     std::vector<R3> propfunc_results;
     // Results of \p propfunc per segment.
     std::vector<typename R3::value_type> results;
+
+    /// @brief Returns the number of bytes allocated by the cache.
+    /// The additional items of the findfunc results and heap memory of the
+    /// props are not accounted for.
+    std::size_t memory_footprint() const {
+        using internal::vector_footprint;
+        return sizeof(*this) +
+               SIZET(xdata.size() + ydata.size()) * sizeof(double) +
+               vector_footprint(chunkindex) +
+               internal::findfunc_results_footprint(findfunc_results) +
+               vector_footprint(segmentindex) +
+               vector_footprint(propfunc_results) + vector_footprint(results);
+    }
+};
+
+/**
+ * @brief Lightweight variant of \ref DivConqFinderStateCache.
+ * This is created by \ref divconqfinder if both template parameters
+ * \p ReturnStateCache and \p RefStateCache are set.
+ * The xdata and ydata are maps into the caller's data, which have to
+ * outlive the cache. The per-chunk results are moved into slots allocated
+ * beforehand. The valid props are only held by the results returned along
+ * with the cache, into which the cache keeps the index.
+ * @note The slots are written concurrently by the tasks, and each task
+ * only writes to its own slot, so the cache should not be accessed until
+ * \ref divconqfinder returns.
+ */
+template <typename XMap, typename YMap, typename R1, typename R2,
+          typename R3>
+struct DivConqFinderStateCacheRef {
+    /// Map of the xdata.
+    XMap xdata{nullptr, 0};
+    /// Map of the ydata.
+    YMap ydata{nullptr, 0};
+    /// Index of chunks from \p chunkfunc.
+    R1 chunkindex;
+    /// Results of \p findfunc per chunk.
+    std::vector<R2> findfunc_results;
+    /// Index of segments of found features.
+    R1 segmentindex;
+    /// Index of the valid prop of each segment in the results, or -1 if
+    /// \p propfunc returns null for the segment.
+    std::vector<Index> propindex;
+
+    /// @brief Returns the number of bytes allocated by the cache.
+    /// The mapped data, the additional items of the findfunc results and
+    /// heap memory of the props are not accounted for.
+    std::size_t memory_footprint() const {
+        using internal::vector_footprint;
+        return sizeof(*this) + vector_footprint(chunkindex) +
+               internal::findfunc_results_footprint(findfunc_results) +
+               vector_footprint(segmentindex) + vector_footprint(propindex);
+    }
 };
 
+/**
+ * @brief Merge sorted runs of feature index to segments of consecutive
+ * index.
+ * The runs are merged with a k-way merge and the segments are created on
+ * the fly. Duplicated index from overlapping runs are merged.
+ * @param runs The sorted runs of feature index.
+ * @return Vector of pairs (si, ei) such that each defines a segment
+ * [si, ei) of consecutive index.
+ */
+template <typename RunIt>
+std::vector<std::pair<Index, Index>> merge_feature_runs(RunIt first,
+                                                        RunIt last) {
+    using iter_t =
+        typename std::iterator_traits<RunIt>::value_type::const_iterator;
+    // min-heap of the heads of the runs
+    std::vector<std::pair<iter_t, iter_t>> heads;
+    for (; first != last; ++first) {
+        if (!first->empty()) {
+            heads.emplace_back(first->cbegin(), first->cend());
+        }
+    }
+    auto cmp = [](const auto &lhs, const auto &rhs) {
+        return *lhs.first > *rhs.first;
+    };
+    std::make_heap(heads.begin(), heads.end(), cmp);
+    std::vector<std::pair<Index, Index>> segmentindex;
+    while (!heads.empty()) {
+        std::pop_heap(heads.begin(), heads.end(), cmp);
+        auto &[it, end] = heads.back();
+        // consume the run as long as it stays at the front
+        auto next = heads.size() > 1 ? *heads.front().first
+                                     : std::numeric_limits<Index>::max();
+        for (; it != end && *it <= next; ++it) {
+            auto i = static_cast<Index>(*it);
+            if (segmentindex.empty() || segmentindex.back().second < i) {
+                segmentindex.emplace_back(i, i + 1); // [begin, past-last]
+            } else if (segmentindex.back().second == i) {
+                ++(segmentindex.back().second);
+            }
+        }
+        if (it == end) {
+            heads.pop_back();
+        } else {
+            std::push_heap(heads.begin(), heads.end(), cmp);
+        }
+    }
+    return segmentindex;
+}
+
+/// @brief Merge sorted runs of feature index in container \p runs.
+/// @see merge_feature_runs
+template <typename Runs>
+std::vector<std::pair<Index, Index>> merge_feature_runs(const Runs &runs) {
+    return merge_feature_runs(runs.begin(), runs.end());
+}
+
+namespace internal {
+
+/**
+ * @brief Run \p findfunc on \p chunk of \p xvec and \p yvec.
+ * @param on_result Callable invoked with the result if features are found,
+ * with the feature index relative to \p xvec.
+ * @tparam MoveResult If true, \p on_result may move from the result, and
+ * the feature index is copied instead of moved out of the result.
+ * @return The sorted feature index relative to \p xvec.
+ */
+template <bool MoveResult = false, typename XVec, typename YVec,
+          typename Chunk, typename Func, typename OnResult>
+std::vector<Index> find_run(const XVec &xvec, const YVec &yvec,
+                            const Chunk &chunk, const Func &findfunc,
+                            OnResult &&on_result) {
+    auto size = chunk.second - chunk.first;
+    //SPDLOG_TRACE("findfunc on chunk [{}, {}) size={}",
+    //             chunk.first, chunk.second, size);
+    auto result = findfunc(xvec.segment(chunk.first, size),
+                           yvec.segment(chunk.first, size));
+    // shortcut to return empty if nothing found
+    if (!result.has_value()) {
+        return {};
+    }
+    // get the feature index vector
+    auto &index = std::get<0>(result.value());
+    SPDLOG_TRACE("feature of length {} found in chunk [{}, {}) size={}",
+                 index.size(), chunk.first, chunk.second, size);
+    // restore the correct index w.r.t. the original data
+    for (auto &i : index) {
+        i += chunk.first;
+    }
+    auto sorted = [](auto &&run) {
+        if (!std::is_sorted(run.begin(), run.end())) {
+            std::sort(run.begin(), run.end());
+        }
+        return std::move(run);
+    };
+    if constexpr (MoveResult) {
+        std::vector<Index> run(index.begin(), index.end());
+        on_result(result);
+        return sorted(std::move(run));
+    } else {
+        on_result(result);
+        return sorted(std::move(index));
+    }
+}
+
+/**
+ * @brief Run \p findfunc on each chunk and merge the found feature index to
+ * segments.
+ * @param iex The instrumented GRPPI execution object.
+ * @param on_result Callable invoked with (ichunk, result) for each chunk
+ * that has features found. The feature index in the result is relative to
+ * \p xvec.
+ * @return The feature segments in index of \p xvec.
+ * @see find_run
+ */
+template <bool MoveResult = false, typename IEx, typename XVec,
+          typename YVec, typename ChunkIndex, typename Func,
+          typename OnResult>
+std::vector<std::pair<Index, Index>>
+find_segments(IEx &iex, const XVec &xvec, const YVec &yvec,
+              const ChunkIndex &chunkindex, const Func &findfunc,
+              OnResult &&on_result) {
+    // for each chunk, run findfunc to get the sorted run of feature index
+    auto chunkindex_ = container_utils::views::enumerate(chunkindex);
+    std::vector<std::vector<Index>> featureruns(chunkindex.size());
+    grppi::map(
+        iex.ex(), chunkindex_.begin(), chunkindex_.end(), featureruns.begin(),
+        // nested execution in findfunc is limited to the thread budget
+        iex.wrap(grppiex::budget_region(
+            [&xvec, &yvec, &findfunc, &on_result](const auto &chunk_) {
+                auto ichunk = chunk_.first;
+                return find_run<MoveResult>(
+                    xvec, yvec, chunk_.second, findfunc,
+                    [&](auto &result) { on_result(ichunk, result); });
+            })));
+    // merge the runs of consecutive feature index to create segmentindex
+    auto segmentindex = merge_feature_runs(featureruns);
+    SPDLOG_DEBUG("found {} feature segments", segmentindex.size());
+    SPDLOG_DEBUG("findfunc telemetry: {}", iex.snapshot());
+    iex.reset();
+    return segmentindex;
+}
+
+/**
+ * @brief Run \p propfunc on each segment and collect the valid results.
+ * @param iex The instrumented GRPPI execution object.
+ * @param on_result Callable invoked with (isegment, result) for each
+ * segment, before the valid result is moved to the output.
+ */
+template <typename Prop, typename IEx, typename XVec, typename YVec,
+          typename SegmentIndex, typename Func, typename OnResult>
+std::vector<Prop> compute_props(IEx &iex, const XVec &xvec, const YVec &yvec,
+                                const SegmentIndex &segmentindex,
+                                const Func &propfunc, OnResult &&on_result) {
+    // grppi call for each feature
+    // aggregate the found props to a vector
+    auto segmentindex_ = container_utils::views::enumerate(segmentindex);
+    auto results = grppi::map_reduce(
+        iex.ex(),
+        // for each feature, run propfunc and aggregate the result to a
+        // vector
+        segmentindex_.begin(), segmentindex_.end(), std::vector<Prop>{},
+        iex.wrap(grppiex::budget_region([&xvec, &yvec, &propfunc, &on_result](
+                                            const auto &segment_) {
+            const auto &[isegment, segment] = segment_;
+            auto size = segment.second - segment.first;
+            // SPDLOG_TRACE("checking feature #{} [{}, {}]", isegment,
+            // segment.first, segment.second); compute property
+            auto result = propfunc(xvec.segment(segment.first, size),
+                                   yvec.segment(segment.first, size));
+            on_result(isegment, std::as_const(result));
+            std::vector<Prop> valid{};
+            if (result.has_value()) {
+                valid.push_back(std::move(result.value()));
+            }
+            return valid;
+        })),
+        // reduction op to merge the results if has value
+        [](auto &&lhs, auto &&rhs) {
+            lhs.insert(lhs.end(), std::make_move_iterator(rhs.begin()),
+                       std::make_move_iterator(rhs.end()));
+            return lhs;
+        });
+    SPDLOG_TRACE("number of results: {}", results.size());
+    SPDLOG_DEBUG("propfunc telemetry: {}", iex.snapshot());
+    iex.reset();
+    return results;
+}
+
+/// @brief Returns instrumented execution object for the finder tasks.
+/// The load balance of the tasks is recorded if debug log is enabled.
+inline auto finder_ex(grppiex::Mode exmode) {
+    return grppiex::instrument<logging::active_level <= spdlog::level::debug>(
+        grppiex::shared_ex(exmode));
+}
+
+} // namespace internal
+
 /**
  * @brief A divide-and-conquer feature detection algorithm.
  *  The returned functor takes a pair of xdata and ydata, produces
@@ -62,16 +340,22 @@ struct DivConqFinderStateCache {
  *  - Return: Optional tuple. The tuple contains properties computed
  *  for each feature segment. The first item of the properties should
  *  be of scalar type such that an Eigen vector could be constructed.
- * @param exmode The GRPPI execution mode to use.
+ * @param exmode The GRPPI execution mode to use. \ref grppiex::Mode::tbb
+ * balances chunks of uneven cost better than the statically partitioned
+ * modes.
  * @tparam ReturnStateCache If true, a DivConqFinderStateCache object contains
  *  the intermediate results is created, populated, and returned.
+ * @tparam RefStateCache If true, the lightweight DivConqFinderStateCacheRef
+ *  is used as the state cache, which maps the input data and moves the
+ *  results in.
  * @return Functor that perform the feature detection.
  *  Expected signature: vector<tuple<Scalar, ...>>(Data, Data)
  *  - Params: xdata and ydata that is sorted, and mappable (contiguous in
  * memory) to Eigen::Vector.
  *  - Return: vector of non-null propfunc results.
  */
-template <bool ReturnStateCache = false, typename F1, typename F2, typename F3,
+template <bool ReturnStateCache = false, bool RefStateCache = false,
+          typename F1, typename F2, typename F3,
           // set up compile type constraits for the functors
           typename R1 = REQUIRES_RT(
               meta::rt_is_instance<std::vector, std::pair, F1, Index>),
@@ -104,8 +388,17 @@ auto divconqfinder(F1 &&chunkfunc, F2 &&findfunc, F3 &&propfunc,
 
         // algorithm starts here
         // create empty cache object
-        auto cache = DivConqFinderStateCache<F1, F2, F3, R1, R2, R3>();
-        auto ex = grppiex::dyn_ex(exmode);
+        constexpr auto use_ref_cache = ReturnStateCache && RefStateCache;
+        auto cache = [&]() {
+            if constexpr (use_ref_cache) {
+                return DivConqFinderStateCacheRef<decltype(xvec),
+                                                  decltype(yvec), R1, R2, R3>{
+                    xvec, yvec};
+            } else {
+                return DivConqFinderStateCache<F1, F2, F3, R1, R2, R3>();
+            }
+        }();
+        auto iex = internal::finder_ex(exmode);
         // create chunks
         auto chunkindex = FWD(chunkfunc)(xvec.size());
         // update cache
@@ -114,106 +407,58 @@ auto divconqfinder(F1 &&chunkfunc, F2 &&findfunc, F3 &&propfunc,
             SPDLOG_TRACE("cache: xdata {}", xvec);
             SPDLOG_TRACE("cache: ydata {}", yvec);
             SPDLOG_TRACE("cache: nchunks={}", nchunks);
-            cache.xdata = xvec;
-            cache.ydata = yvec;
+            if constexpr (!use_ref_cache) {
+                cache.xdata = xvec;
+                cache.ydata = yvec;
+            }
             cache.chunkindex = chunkindex;
             // allocate findfunc_results
             cache.findfunc_results.resize(nchunks);
         }
         // find features
-        auto featureindex = grppi::map_reduce(
-            ex,
-            // for each chunk, run findfunc and aggregate the result to a set.
-            container_utils::unordered_enumerate(chunkindex),
-            std::set<Index>{},
-            [&xvec, &yvec, &cache, fargs = FWD_CAPTURE(findfunc)](
-                const auto &chunk_) -> std::vector<Index> {
-                auto &&[findfunc] = fargs;
-                const auto &[ichunk, chunk] = chunk_;
-                auto size = chunk.second - chunk.first;
-                //SPDLOG_TRACE("findfunc on chunk #{} [{}, {}) size={}",
-                //             ichunk, chunk.first, chunk.second, size);
-                auto result = FWD(findfunc)(xvec.segment(chunk.first, size),
-                                            yvec.segment(chunk.first, size));
-                // shortcut to return empty if nothing found
-                if (!result.has_value()) {
-                    return {};
-                }
-                // get the feature index vector
-                auto &index = std::get<0>(result.value());
-                SPDLOG_TRACE("feature of length {} found in chunk #{} [{}, "
-                             "{}) size={}",
-                             index.size(), ichunk, chunk.first, chunk.second,
-                             size);
-                // restore the correct index w.r.t. the original data
-                for (auto &i : index) {
-                    i += chunk.first;
-                }
+        // each task only writes to its own slot of the cache
+        auto segmentindex = internal::find_segments<use_ref_cache>(
+            iex, xvec, yvec, chunkindex, findfunc,
+            [&cache](auto ichunk, auto &result) {
                 // update cache
-                if constexpr (ReturnStateCache) {
+                if constexpr (use_ref_cache) {
+                    cache.findfunc_results[ichunk] = std::move(result);
+                } else if constexpr (ReturnStateCache) {
                     cache.findfunc_results[ichunk] = result;
                 }
-                return std::move(index);
-            },
-            // reduction op to merge the results to a set
-            [](auto &&lhs, auto &&rhs) {
-                lhs.insert(std::make_move_iterator(rhs.begin()),
-                           std::make_move_iterator(rhs.end()));
-                return lhs;
             });
-        // merge the peak of consecutive feature index to one to create
-        // segmentindex
-        std::vector<std::pair<Index, Index>> segmentindex;
-        for (auto i : featureindex) {
-            if (segmentindex.empty() || segmentindex.back().second < i) {
-                segmentindex.emplace_back(i, i + 1); // [begin, past-last] range
-            } else {
-                ++(segmentindex.back().second);
-            }
-        }
-        SPDLOG_DEBUG("found {} feature segments", segmentindex.size());
         // update cache
-        if constexpr (ReturnStateCache) {
+        if constexpr (use_ref_cache) {
+            cache.segmentindex = segmentindex;
+            cache.propindex.resize(segmentindex.size());
+        } else if constexpr (ReturnStateCache) {
             cache.segmentindex = segmentindex;
             cache.propfunc_results.resize(segmentindex.size());
         }
-        // grppi call for each feature
-        // aggregate the found props to a vector
         using Prop = typename R3::value_type; // type of the valid property
-        auto segmentindex_ = container_utils::unordered_enumerate(segmentindex);
-        auto results = grppi::map_reduce(
-            ex,
-            // for each feature, run propfunc and aggregate the result to a
-            // vector
-            segmentindex_.begin(), segmentindex_.end(), std::vector<Prop>{},
-            [&xvec, &yvec, &cache,
-             fargs = FWD_CAPTURE(propfunc)](const auto &segment_) {
-                auto &&[propfunc] = fargs;
-                const auto &[isegment, segment] = segment_;
-                auto size = segment.second - segment.first;
-                // SPDLOG_TRACE("checking feature #{} [{}, {}]", isegment,
-                // segment.first, segment.second); compute property
-                auto result = FWD(propfunc)(xvec.segment(segment.first, size),
-                                            yvec.segment(segment.first, size));
+        auto results = internal::compute_props<Prop>(
+            iex, xvec, yvec, segmentindex, propfunc,
+            [&cache](auto isegment, const auto &result) {
                 // update cache
-                if constexpr (ReturnStateCache) {
+                if constexpr (use_ref_cache) {
+                    cache.propindex[isegment] = result.has_value() ? 0 : -1;
+                } else if constexpr (ReturnStateCache) {
                     cache.propfunc_results[isegment] = result;
                 }
-                if (result.has_value()) {
-                    return std::vector<Prop>{result.value()};
-                }
-                return std::vector<Prop>{};
-            },
-            // reduction op to merge the results if has value
-            [](auto &&lhs, auto &&rhs) {
-                lhs.insert(lhs.end(),
-                           std::make_move_iterator(rhs.begin()),
-                           std::make_move_iterator(rhs.end()));
-                return lhs;
             });
-        SPDLOG_TRACE("number of results: {}", results.size());
+        if constexpr (use_ref_cache) {
+            // the valid props are in the order of the segments
+            Index i = 0;
+            for (auto &p : cache.propindex) {
+                if (p >= 0) {
+                    p = i++;
+                }
+            }
+        }
         if constexpr (ReturnStateCache) {
-            cache.results = results;
+            if constexpr (!use_ref_cache) {
+                cache.results = results;
+            }
             return std::make_tuple(std::move(results), std::move(cache));
         } else {
             return results;
@@ -221,5 +466,280 @@ auto divconqfinder(F1 &&chunkfunc, F2 &&findfunc, F3 &&propfunc,
     };
 }
 
+/**
+ * @brief Batched variant of \ref divconqfinder for multiple channels.
+ * The returned functor runs the detection on each column of ydata. The
+ * (channel, chunk) and (channel, segment) pairs are scheduled as flat
+ * parallel jobs, so that small channels do not leave workers idle.
+ * @see divconqfinder for the functors.
+ * @return Functor that perform the feature detection.
+ *  Expected signature: vector<vector<tuple<Scalar, ...>>>(XData, YData)
+ *  - Params: xdata and ydata matrices of the same number of rows, with
+ *  the channels as columns. xdata may have one column that is shared among
+ *  all channels.
+ *  - Return: vector of non-null propfunc results per channel, in the
+ *  order of the feature segments.
+ */
+template <typename F1, typename F2, typename F3,
+          // set up compile type constraits for the functors
+          typename R1 = REQUIRES_RT(
+              meta::rt_is_instance<std::vector, std::pair, F1, Index>),
+          typename R2 = REQUIRES_RT(
+              meta::rt_is_instance<std::optional, std::tuple, F2,
+                                   Eigen::VectorXd, Eigen::VectorXd>),
+          typename R3 = REQUIRES_RT(
+              meta::rt_is_instance<std::optional, std::tuple, F3,
+                                   Eigen::VectorXd, Eigen::VectorXd>)>
+auto divconqfinder_batch(F1 &&chunkfunc, F2 &&findfunc, F3 &&propfunc,
+                         grppiex::Mode exmode = grppiex::default_mode()) {
+    return [fargs = FWD_CAPTURE(chunkfunc, findfunc, propfunc),
+            exmode](const auto &xdata, const auto &ydata) {
+        // unpack the functors, as references that the tasks can capture
+        const auto &chunkfunc = std::get<0>(fargs);
+        const auto &findfunc = std::get<1>(fargs);
+        const auto &propfunc = std::get<2>(fargs);
+        using Prop = typename R3::value_type; // type of the valid property
+        const auto n_channels = ydata.cols();
+        const auto n_samples = ydata.rows();
+        if (xdata.rows() != n_samples ||
+            (xdata.cols() != 1 && xdata.cols() != n_channels)) {
+            throw std::runtime_error(fmt::format(
+                "mismatch xdata shape ({}, {}) and ydata shape ({}, {})",
+                xdata.rows(), xdata.cols(), n_samples, n_channels));
+        }
+        auto xcol = [&xdata](Index c) {
+            return xdata.col(xdata.cols() == 1 ? 0 : c);
+        };
+        auto iex = internal::finder_ex(exmode);
+        // create chunks, shared by all channels
+        auto chunkindex = chunkfunc(n_samples);
+        const auto n_chunks = static_cast<Index>(chunkindex.size());
+        auto noop = [](auto &&...) {};
+        // find features for all (channel, chunk)
+        auto chunktasks = container_utils::views::iota(n_channels * n_chunks);
+        std::vector<std::vector<Index>> featureruns(chunktasks.size());
+        grppi::map(iex.ex(), chunktasks.begin(), chunktasks.end(),
+                   featureruns.begin(),
+                   iex.wrap(grppiex::budget_region([&](Index t) {
+                       auto c = t / n_chunks;
+                       return internal::find_run(
+                           xcol(c), ydata.col(c),
+                           chunkindex[static_cast<std::size_t>(t % n_chunks)],
+                           findfunc, noop);
+                   })));
+        SPDLOG_DEBUG("findfunc telemetry: {}", iex.snapshot());
+        iex.reset();
+        // merge the runs of each channel, and flatten the segments to
+        // (channel, segment)
+        std::vector<std::vector<std::pair<Index, Index>>> segmentindex(
+            static_cast<std::size_t>(n_channels));
+        std::vector<std::pair<Index, std::pair<Index, Index>>> segmenttasks;
+        for (Index c = 0; c < n_channels; ++c) {
+            auto first = featureruns.begin() + c * n_chunks;
+            auto &segments = segmentindex[static_cast<std::size_t>(c)];
+            segments = merge_feature_runs(first, first + n_chunks);
+            for (const auto &segment : segments) {
+                segmenttasks.emplace_back(c, segment);
+            }
+        }
+        SPDLOG_DEBUG("found {} feature segments in {} channels",
+                     segmenttasks.size(), n_channels);
+        // compute props for all (channel, segment)
+        std::vector<std::optional<Prop>> props(segmenttasks.size());
+        grppi::map(
+            iex.ex(), segmenttasks.begin(), segmenttasks.end(), props.begin(),
+            iex.wrap(grppiex::budget_region([&](const auto &task) {
+                const auto &[c, segment] = task;
+                auto size = segment.second - segment.first;
+                return propfunc(xcol(c).segment(segment.first, size),
+                                ydata.col(c).segment(segment.first, size));
+            })));
+        SPDLOG_DEBUG("propfunc telemetry: {}", iex.snapshot());
+        // collect the results per channel
+        std::vector<std::vector<Prop>> results(
+            static_cast<std::size_t>(n_channels));
+        for (std::size_t i = 0; i < props.size(); ++i) {
+            if (props[i].has_value()) {
+                results[static_cast<std::size_t>(segmenttasks[i].first)]
+                    .push_back(std::move(props[i].value()));
+            }
+        }
+        return results;
+    };
+}
+
+/**
+ * @brief Streaming variant of \ref divconqfinder.
+ * The data are pushed in successive blocks. Each push runs the detection
+ * on the new block together with the data carried over from the previous
+ * ones, and returns the \p propfunc results of the feature segments that
+ * are finished. A segment is finished when it ends before the last
+ * \p margin samples, which are the context \p chunkfunc and \p findfunc
+ * need to detect the features. Segments that are not finished, including
+ * those crossing the block boundaries, are carried over together with
+ * \p margin samples of context on both sides, so the memory is bounded
+ * by the block size, the margins and the length of the open segment.
+ * The carried-over samples are kept at the front of buffers that only
+ * grow geometrically, so pushing does not reallocate in the steady state.
+ * Each push only rescans the samples from \p margin before the finished
+ * part. A segment detected again that started in a previous round, which
+ * happens when the features need more context than \p margin, is clipped
+ * to the samples not finished yet, so the finished segments never overlap.
+ * The index of the finished segments are kept until taken with
+ * \ref pop_finished.
+ * @see divconqfinder for the functors.
+ */
+template <typename F1, typename F2, typename F3> class DivConqFinderStream {
+public:
+    /// The type of the valid property.
+    using Prop = typename std::invoke_result_t<const F3 &, Eigen::VectorXd,
+                                               Eigen::VectorXd>::value_type;
+
+    /// @param margin The number of samples of context needed to detect the
+    /// features.
+    DivConqFinderStream(F1 chunkfunc, F2 findfunc, F3 propfunc, Index margin,
+                        grppiex::Mode exmode = grppiex::default_mode())
+        : m_chunkfunc{std::move(chunkfunc)}, m_findfunc{std::move(findfunc)},
+          m_propfunc{std::move(propfunc)}, m_margin{std::max<Index>(margin, 0)},
+          m_exmode{exmode} {}
+
+    /// @brief Push the next block of sorted xdata and ydata.
+    /// @return The properties of the finished feature segments.
+    template <typename DerivedX, typename DerivedY>
+    std::vector<Prop> push(const Eigen::DenseBase<DerivedX> &xblock,
+                           const Eigen::DenseBase<DerivedY> &yblock) {
+        if (xblock.size() != yblock.size()) {
+            throw std::runtime_error(
+                fmt::format("mismatch xdata size {} and ydata size {}",
+                            xblock.size(), yblock.size()));
+        }
+        append(xblock, yblock);
+        return process(false);
+    }
+
+    /// @brief Finish the stream.
+    /// @return The properties of all the remaining feature segments.
+    std::vector<Prop> finish() { return process(true); }
+
+    /// @brief Returns the global index of the first carried-over sample.
+    Index offset() const { return m_offset; }
+    /// @brief Returns the number of carried-over samples.
+    Index carry_size() const { return m_size; }
+    /// @brief Returns the number of samples the buffers can hold.
+    Index capacity() const { return m_xbuf.size(); }
+    /// @brief Returns the feature segments finished since the last call, in
+    /// global index, and releases them.
+    std::vector<std::pair<Index, Index>> pop_finished() {
+        return std::exchange(m_finished, {});
+    }
+
+private:
+    F1 m_chunkfunc;
+    F2 m_findfunc;
+    F3 m_propfunc;
+    Index m_margin;
+    grppiex::Mode m_exmode;
+    // the samples are held in the first m_size elements
+    Eigen::VectorXd m_xbuf{};
+    Eigen::VectorXd m_ybuf{};
+    Index m_size{0};
+    // global index of the first sample in the buffer
+    Index m_offset{0};
+    // global index before which the detection is finished
+    Index m_done{0};
+    // finished segments not yet popped
+    std::vector<std::pair<Index, Index>> m_finished{};
+
+    template <typename DerivedX, typename DerivedY>
+    void append(const Eigen::DenseBase<DerivedX> &xblock,
+                const Eigen::DenseBase<DerivedY> &yblock) {
+        const auto size = m_size + xblock.size();
+        if (size > m_xbuf.size()) {
+            auto capacity = std::max(size, 2 * m_xbuf.size());
+            m_xbuf.conservativeResize(capacity);
+            m_ybuf.conservativeResize(capacity);
+        }
+        m_xbuf.segment(m_size, xblock.size()) = xblock.derived();
+        m_ybuf.segment(m_size, yblock.size()) = yblock.derived();
+        m_size = size;
+    }
+
+    // drop the first n samples
+    void discard(Index n) {
+        const auto size = m_size - n;
+        // ranges overlap, copy towards the front
+        std::copy(m_xbuf.data() + n, m_xbuf.data() + m_size, m_xbuf.data());
+        std::copy(m_ybuf.data() + n, m_ybuf.data() + m_size, m_ybuf.data());
+        m_size = size;
+        m_offset += n;
+    }
+
+    std::vector<Prop> process(bool final) {
+        const auto n = m_size;
+        // the samples before safe have enough context
+        const auto safe = final ? n : n - m_margin;
+        if (safe <= 0) {
+            return {};
+        }
+        // the samples before done are finished in previous rounds, and only
+        // the margin before them is rescanned
+        const auto done = std::clamp<Index>(m_done - m_offset, 0, n);
+        const auto start = std::max<Index>(done - m_margin, 0);
+        auto iex = internal::finder_ex(m_exmode);
+        auto noop = [](auto &&...) {};
+        auto xvec = m_xbuf.segment(start, n - start);
+        auto yvec = m_ybuf.segment(start, n - start);
+        auto chunkindex = m_chunkfunc(n - start);
+        auto segmentindex = internal::find_segments(
+            iex, xvec, yvec, chunkindex, m_findfunc, noop);
+        // collect the segments finished in this round, relative to start
+        std::vector<std::pair<Index, Index>> finished;
+        auto carry = safe;
+        for (auto segment : segmentindex) {
+            const auto si = segment.first + start;
+            const auto ei = segment.second + start;
+            // skip those done in previous rounds
+            if (ei <= done) {
+                continue;
+            }
+            if (!final && ei >= safe) {
+                carry = std::min(carry, std::max(si, done));
+                break;
+            }
+            // clip those that grow out of a done segment
+            if (si < done) {
+                segment.first = done - start;
+            }
+            finished.push_back(segment);
+        }
+        auto results = internal::compute_props<Prop>(
+            iex, xvec, yvec, finished, m_propfunc, noop);
+        for (const auto &segment : finished) {
+            m_finished.emplace_back(segment.first + start + m_offset,
+                                    segment.second + start + m_offset);
+        }
+        m_done = m_offset + carry;
+        // keep the open segment and the context around it
+        discard(final ? n : std::max<Index>(carry - m_margin, 0));
+        SPDLOG_DEBUG("stream finished {} segments, carry over {} samples "
+                     "from {}",
+                     finished.size(), m_size, m_offset);
+        return results;
+    }
+};
+
+/**
+ * @brief Create streaming feature detector.
+ * @see DivConqFinderStream
+ */
+template <typename F1, typename F2, typename F3>
+auto divconqfinder_stream(F1 &&chunkfunc, F2 &&findfunc, F3 &&propfunc,
+                          Index margin,
+                          grppiex::Mode exmode = grppiex::default_mode()) {
+    return DivConqFinderStream<std::decay_t<F1>, std::decay_t<F2>,
+                               std::decay_t<F3>>(
+        FWD(chunkfunc), FWD(findfunc), FWD(propfunc), margin, exmode);
+}
+
 } // namespace detect1d
 } // namespace finder
\ No newline at end of file
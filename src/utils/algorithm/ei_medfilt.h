@@ -0,0 +1,281 @@
+#pragma once
+
+#include "../eigen.h"
+#include "../grppiex.h"
+#include "../grppiex/grain.h"
+#include "ei_convolve.h"
+#include "ei_stats.h"
+#include <cmath>
+#include <limits>
+#include <set>
+
+namespace alg {
+
+/**
+ * @brief Median of a sliding window.
+ * The values are kept in two sorted halves, such that the median is given by
+ * the largest value of the lower half and the smallest value of the upper
+ * half. Each update costs O(log w) for window size w. Replacing a value
+ * reuses the node of the removed value, so a window sliding with
+ * \ref replace does not allocate.
+ * NaN values are skipped, such that the median is that of the other values
+ * in the window, or NaN if there are none.
+ */
+template <typename T> class RunningMedian {
+public:
+    using value_type = T;
+
+    /// @brief Returns the number of non-NaN values in the window.
+    std::size_t size() const { return m_lo.size() + m_hi.size(); }
+    /// @brief Returns true if the window has no non-NaN values.
+    bool empty() const { return m_lo.empty(); }
+    /// @brief Remove all values.
+    void clear() {
+        m_lo.clear();
+        m_hi.clear();
+    }
+
+    /// @brief Add value \p x.
+    void push(T x) {
+        if (is_nan(x)) {
+            return;
+        }
+        half_of(x).insert(x);
+        rebalance();
+    }
+
+    /// @brief Remove value \p x, which has to be in the window.
+    void pop(T x) {
+        if (is_nan(x)) {
+            return;
+        }
+        half_of(x).erase(find(x));
+        rebalance();
+    }
+
+    /// @brief Replace value \p old in the window with \p x.
+    void replace(T old, T x) {
+        if (is_nan(old) || is_nan(x)) {
+            pop(old);
+            push(x);
+            return;
+        }
+        auto node = half_of(old).extract(find(old));
+        node.value() = x;
+        half_of(x).insert(std::move(node));
+        rebalance();
+    }
+
+    /// @brief Returns the median of the values in the window.
+    /// @note Promotes to double.
+    double median() const {
+        if (empty()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        if (m_lo.size() > m_hi.size()) {
+            return *m_lo.rbegin() * 1.0;
+        }
+        // even sized window -> average the two middle values
+        return (*m_lo.rbegin() + *m_hi.begin()) / 2.0;
+    }
+
+private:
+    // all values in m_lo are not greater than those in m_hi, and the size
+    // of m_lo is that of m_hi, or one more
+    std::multiset<T> m_lo;
+    std::multiset<T> m_hi;
+
+    static bool is_nan(T x) {
+        if constexpr (std::is_floating_point_v<T>) {
+            return std::isnan(x);
+        } else {
+            return false;
+        }
+    }
+    // the half to hold x
+    std::multiset<T> &half_of(T x) {
+        return (m_hi.empty() || x < *m_hi.begin()) ? m_lo : m_hi;
+    }
+    auto find(T x) {
+        auto &half = half_of(x);
+        auto it = half.find(x);
+        if (it == half.end()) {
+            throw std::runtime_error(
+                fmt::format("value {} not in running median window", x));
+        }
+        return it;
+    }
+    void rebalance() {
+        while (m_lo.size() > m_hi.size() + 1) {
+            m_hi.insert(m_lo.extract(std::prev(m_lo.end())));
+        }
+        while (m_hi.size() > m_lo.size()) {
+            m_lo.insert(m_hi.extract(m_hi.begin()));
+        }
+    }
+};
+
+namespace internal {
+
+// median filter of the windows starting at padded[begin, end)
+template <typename Derived, typename Output>
+void medfilt1d_run(const Eigen::DenseBase<Derived> &padded, Eigen::Index size,
+                   Eigen::Index begin, Eigen::Index end, Output &output) {
+    using Scalar = typename Derived::Scalar;
+    using Eigen::Index;
+    RunningMedian<Scalar> window;
+    for (Index i = begin; i < begin + size; ++i) {
+        window.push(padded.coeff(i));
+    }
+    output.coeffRef(begin) = static_cast<Scalar>(window.median());
+    for (Index i = begin + 1; i < end; ++i) {
+        window.replace(padded.coeff(i - 1), padded.coeff(i + size - 1));
+        output.coeffRef(i) = static_cast<Scalar>(window.median());
+    }
+}
+
+// median filter of the windows starting at padded[begin, end), by the
+// network run over blocks of windows, with one window per SIMD lane
+template <Eigen::Index size, typename Derived, typename Output>
+void medfilt1d_run_network(const Eigen::DenseBase<Derived> &padded,
+                           Eigen::Index begin, Eigen::Index end,
+                           Output &output) {
+    using Scalar = typename Derived::Scalar;
+    using Eigen::Index;
+    constexpr Index block_size = 256;
+    using block_t = Eigen::Array<Scalar, block_size, 1>;
+    std::array<block_t, size> v;
+    const auto &p = padded.derived();
+    Index i = begin;
+    for (; i + block_size <= end; i += block_size) {
+        for (Index k = 0; k < size; ++k) {
+            v[k] = p.template segment<block_size>(i + k).array();
+        }
+        median_network_apply<size>(v);
+        output.template segment<block_size>(i).array() = v[size / 2];
+    }
+    for (; i < end; ++i) {
+        output.coeffRef(i) = median_network_select<size>(p.segment(i, size));
+    }
+}
+
+template <BorderMode mode, typename Derived, typename F>
+auto medfilt1d_apply(const Eigen::DenseBase<Derived> &data, Eigen::Index size,
+                     F &&run) {
+    static_assert(Derived::IsVectorAtCompileTime, "EXPECT VECTOR");
+    const auto n = data.size();
+    if (size < 1 || n < size) {
+        throw std::runtime_error(fmt::format(
+            "invalid medfilt window size {} for data size {}", size, n));
+    }
+    typename Derived::PlainObject output(n);
+    if (size == 1) {
+        output = data;
+        return output;
+    }
+    const auto padded = borderpad1d<mode>(data.derived(), size);
+    FWD(run)(padded, output);
+    return output;
+}
+
+} // namespace internal
+
+/**
+ * @brief Median filter.
+ * The median is computed with \ref RunningMedian in O(n log w) for data of
+ * size n and window size w. NaN values are skipped, see \ref RunningMedian.
+ * @tparam mode The border mode to pad the data. The padding is done per
+ * window position, such that the border windows are centered at the
+ * border samples.
+ * @param data The data vector, of size not less than \p size.
+ * @param size The window size.
+ */
+template <BorderMode mode = BorderMode::Mirror, typename Derived>
+auto medfilt1d(const Eigen::DenseBase<Derived> &data, Eigen::Index size) {
+    return internal::medfilt1d_apply<mode>(
+        data, size, [&](const auto &padded, auto &output) {
+            internal::medfilt1d_run(padded, size, 0, output.size(), output);
+        });
+}
+
+/**
+ * @brief Median filter, computed in parallel with \p ex.
+ * The data are split into chunks, each of which is filtered with its own
+ * running median, starting from the window overlapping with the previous
+ * chunk.
+ * @param chunk_size The min number of outputs per chunk. The chunks are
+ * made larger than the window size to keep the overhead of the overlap low.
+ * @see medfilt1d
+ */
+template <BorderMode mode = BorderMode::Mirror, typename Derived>
+auto medfilt1d(const grppi::dynamic_execution &ex,
+               const Eigen::DenseBase<Derived> &data, Eigen::Index size,
+               Eigen::Index chunk_size = 4096) {
+    return internal::medfilt1d_apply<mode>(
+        data, size, [&](const auto &padded, auto &output) {
+            auto grain =
+                grppiex::Grain::fixed(std::max(chunk_size, 16 * size));
+            grppiex::for_each_block(
+                ex, output.size(),
+                [&](auto begin, auto end) {
+                    internal::medfilt1d_run(padded, size, begin, end, output);
+                },
+                grain);
+        });
+}
+
+/**
+ * @brief Median filter of compile-time window size.
+ * For the window sizes 3, 5, 7, and 9, the median is computed with
+ * branchless selection networks over blocks of windows, which vectorizes.
+ * Other sizes, and data with NaN values, use the running median.
+ * @see medfilt1d
+ */
+template <Eigen::Index size, BorderMode mode = BorderMode::Mirror,
+          typename Derived>
+auto medfilt1d(const Eigen::DenseBase<Derived> &data) {
+    if constexpr (internal::median_network<size>::value) {
+        if (data.hasNaN()) {
+            return medfilt1d<mode>(data, size);
+        }
+        return internal::medfilt1d_apply<mode>(
+            data, size, [](const auto &padded, auto &output) {
+                internal::medfilt1d_run_network<size>(padded, 0, output.size(),
+                                                      output);
+            });
+    } else {
+        return medfilt1d<mode>(data, size);
+    }
+}
+
+/**
+ * @brief Median filter of compile-time window size, computed in parallel
+ * with \p ex.
+ * @see medfilt1d
+ */
+template <Eigen::Index size, BorderMode mode = BorderMode::Mirror,
+          typename Derived>
+auto medfilt1d(const grppi::dynamic_execution &ex,
+               const Eigen::DenseBase<Derived> &data,
+               Eigen::Index chunk_size = 4096) {
+    if constexpr (internal::median_network<size>::value) {
+        if (data.hasNaN()) {
+            return medfilt1d<mode>(ex, data, size, chunk_size);
+        }
+        return internal::medfilt1d_apply<mode>(
+            data, size, [&](const auto &padded, auto &output) {
+                auto grain = grppiex::Grain::fixed(chunk_size);
+                grppiex::for_each_block(
+                    ex, output.size(),
+                    [&](auto begin, auto end) {
+                        internal::medfilt1d_run_network<size>(padded, begin,
+                                                              end, output);
+                    },
+                    grain);
+            });
+    } else {
+        return medfilt1d<mode>(ex, data, size, chunk_size);
+    }
+}
+
+} // namespace alg
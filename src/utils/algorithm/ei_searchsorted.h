@@ -0,0 +1,152 @@
+#pragma once
+
+#include "../eigen.h"
+#include <stdexcept>
+#include <type_traits>
+
+namespace alg {
+
+/// @brief The side of the insertion point. See numpy.searchsorted.
+enum class Side { Left, Right };
+
+namespace internal {
+
+// true if v is to be inserted after x
+template <Side side, typename T, typename U> bool goes_after(T x, U v) {
+    if constexpr (side == Side::Left) {
+        return x < v;
+    } else {
+        return !(v < x);
+    }
+}
+
+// binary search of v in sorted[first, last)
+template <Side side, typename Derived, typename T>
+Eigen::Index bisect(const Eigen::DenseBase<Derived> &sorted, T v,
+                    Eigen::Index first, Eigen::Index last) {
+    while (first < last) {
+        auto mid = first + (last - first) / 2;
+        if (goes_after<side>(sorted.coeff(mid), v)) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+    return first;
+}
+
+} // namespace internal
+
+/**
+ * @brief Return the index at which \p v would be inserted into \p sorted to
+ * keep the order.
+ * With \ref Side::Left, the index is that of the first element not less
+ * than \p v, and with \ref Side::Right, that of the first element greater
+ * than \p v.
+ * @param sorted The vector sorted in ascending order.
+ */
+template <Side side = Side::Left, typename Derived,
+          typename = std::enable_if_t<
+              std::is_arithmetic_v<typename Derived::Scalar>>>
+Eigen::Index searchsorted(const Eigen::DenseBase<Derived> &sorted,
+                          typename Derived::Scalar v) {
+    static_assert(Derived::IsVectorAtCompileTime, "REQUIRES VECTOR TYPE");
+    return internal::bisect<side>(sorted.derived(), v, 0, sorted.size());
+}
+
+/**
+ * @brief Return the insertion indices of \p values into \p sorted.
+ * If \p values are sorted too, they are merged in one sweep over
+ * \p sorted, in which each index is searched from the previous one by
+ * galloping. The cost is then O(m log(n / m)) for m values and n sorted
+ * elements, instead of O(m log n).
+ * @see searchsorted
+ */
+template <Side side = Side::Left, typename DerivedA, typename DerivedB>
+Eigen::VectorXI searchsorted(const Eigen::DenseBase<DerivedA> &sorted,
+                             const Eigen::DenseBase<DerivedB> &values) {
+    static_assert(DerivedA::IsVectorAtCompileTime &&
+                      DerivedB::IsVectorAtCompileTime,
+                  "REQUIRES VECTOR TYPE");
+    using Eigen::Index;
+    const auto &s = sorted.derived();
+    const auto &v = values.derived();
+    const auto n = s.size();
+    Eigen::VectorXI indices(v.size());
+    bool is_sorted = true;
+    for (Index i = 1; i < v.size() && is_sorted; ++i) {
+        is_sorted = !(v.coeff(i) < v.coeff(i - 1));
+    }
+    if (!is_sorted) {
+        for (Index i = 0; i < v.size(); ++i) {
+            indices.coeffRef(i) = internal::bisect<side>(s, v.coeff(i), 0, n);
+        }
+        return indices;
+    }
+    Index first = 0;
+    for (Index i = 0; i < v.size(); ++i) {
+        const auto x = v.coeff(i);
+        // gallop to bracket the index in [first, last)
+        Index step = 1;
+        Index last = first;
+        while (last < n && internal::goes_after<side>(s.coeff(last), x)) {
+            first = last + 1;
+            last += step;
+            step *= 2;
+        }
+        first = internal::bisect<side>(s, x, first, std::min(last, n));
+        indices.coeffRef(i) = first;
+    }
+    return indices;
+}
+
+/**
+ * @brief Return arg nearest in sorted vector.
+ * This is the O(log n) version of \ref argeq for sorted \p sorted. As
+ * with \ref argeq, ties resolve to the first of the nearest elements.
+ * @return The index of the element nearest to \p v, and the difference of
+ * the element to \p v.
+ */
+template <typename Derived, typename = std::enable_if_t<
+                                std::is_arithmetic_v<typename Derived::Scalar>>>
+auto argeq_sorted(const Eigen::DenseBase<Derived> &sorted,
+                  typename Derived::Scalar v) {
+    const auto &s = sorted.derived();
+    if (s.size() == 0) {
+        throw std::runtime_error("argeq_sorted of empty vector");
+    }
+    auto i = searchsorted(s, v);
+    if (i == s.size() ||
+        (i > 0 && v - s.coeff(i - 1) <= s.coeff(i) - v)) {
+        // the nearest element is below v, of which take the first duplicate
+        i = searchsorted(s, s.coeff(i - 1));
+    }
+    return std::make_pair(i, s.coeff(i) - v);
+}
+
+/**
+ * @brief Return slice of sorted vector that has value within given range.
+ * This is the O(log n) version of \ref argwithin for sorted \p sorted,
+ * and is built on \ref argeq_sorted the same way, so the results agree
+ * also for ranges outside of the data, and for \p vmin > \p vmax, for
+ * which end can be less than begin.
+ * @return The index range [begin, end) of elements in [vmin, vmax].
+ */
+template <typename Derived, typename = std::enable_if_t<
+                                std::is_arithmetic_v<typename Derived::Scalar>>>
+auto argwithin_sorted(const Eigen::DenseBase<Derived> &sorted,
+                      typename Derived::Scalar vmin,
+                      typename Derived::Scalar vmax) {
+    const auto &s = sorted.derived();
+    auto [il, epsl] = argeq_sorted(s, vmin);
+    if (epsl < 0) {
+        ++il;
+    }
+    auto [ir, epsr] = argeq_sorted(s, vmax);
+    if (epsr > 0) {
+        --ir;
+    }
+    return std::make_pair(il, ir + 1);
+}
+
+} // namespace alg
@@ -1,7 +1,16 @@
 #pragma once
 
+#include "../container.h"
 #include "../eigen.h"
+#include "../grppiex.h"
+#include "../grppiex/grain.h"
+#include <array>
+#include <cmath>
+#include <limits>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace alg {
 
@@ -101,32 +110,342 @@ auto mean(const Eigen::DenseBase<Derived> &m) {
     return m.sum() / size;
 }
 
+namespace internal {
+
+// move the non-NaN values of vector block b to its head without branching,
+// and returns their number. Blocks without NaN are checked vectorized and
+// left as is
+template <typename Block> Eigen::Index nancompact_inplace(Block &&b) {
+    const auto n = b.size();
+    if ((b.array() == b.array()).all()) {
+        return n;
+    }
+    Eigen::Index k = 0;
+    for (Eigen::Index i = 0; i < n; ++i) {
+        auto x = b.coeff(i);
+        b.coeffRef(k) = x;
+        k += !std::isnan(x);
+    }
+    return k;
+}
+
+} // namespace internal
+
+/**
+ * @brief Mergeable running central moments.
+ * The moments of data blocks are merged with the pairwise update of Chan et
+ * al., which reduces to Welford's algorithm for single values. The state is
+ * trivially copyable, so partial moments can be combined with operator+
+ * across threads (e.g., as the reduction op of grppi::map_reduce) and
+ * across MPI ranks (e.g., with mpi_utils::map_reduce).
+ * @tparam order The highest order of central moment to track: 2 for the
+ * variance, 3 for the skewness, and 4 for the kurtosis.
+ */
+template <int order = 2> struct Moments {
+    static_assert(order >= 2 && order <= 4, "MOMENTS ORDER HAS TO BE 2-4");
+    /// Number of values.
+    double count{0};
+    /// Mean of the values.
+    double mean{0};
+    /// Sum of the powers of deviation from the mean.
+    double M2{0};
+    double M3{0};
+    double M4{0};
+
+    /// @brief Update with value \p x.
+    Moments &push(double x) { return merge(Moments{1, x}); }
+
+    /// @brief Update with the values in \p m.
+    /// The values are evaluated once, in blocks that stay in the cache.
+    template <typename Derived>
+    Moments &push(const Eigen::DenseBase<Derived> &m) {
+        return push_blocks<false>(m);
+    }
+
+    /// @brief Update with the non-NaN values in \p m.
+    /// The values are evaluated once, and the NaNs are removed per block.
+    template <typename Derived>
+    Moments &nanpush(const Eigen::DenseBase<Derived> &m) {
+        return push_blocks<true>(m);
+    }
+
+    /// @brief Merge with moments \p other.
+    Moments &merge(const Moments &other) {
+        const auto na = count;
+        const auto nb = other.count;
+        if (nb == 0) {
+            return *this;
+        }
+        if (na == 0) {
+            return *this = other;
+        }
+        const auto n = na + nb;
+        const auto delta = other.mean - mean;
+        const auto delta2 = delta * delta;
+        // the higher orders use the lower orders before update
+        if constexpr (order >= 4) {
+            M4 += other.M4 +
+                  delta2 * delta2 * na * nb * (na * na - na * nb + nb * nb) /
+                      (n * n * n) +
+                  6. * delta2 * (na * na * other.M2 + nb * nb * M2) / (n * n) +
+                  4. * delta * (na * other.M3 - nb * M3) / n;
+        }
+        if constexpr (order >= 3) {
+            M3 += other.M3 + delta2 * delta * na * nb * (na - nb) / (n * n) +
+                  3. * delta * (na * other.M2 - nb * M2) / n;
+        }
+        M2 += other.M2 + delta2 * na * nb / n;
+        mean += delta * nb / n;
+        count = n;
+        return *this;
+    }
+
+    friend Moments operator+(Moments lhs, const Moments &rhs) {
+        return lhs.merge(rhs);
+    }
+
+    /// @brief Returns the variance.
+    /// @param ddof Delta degree of freedom. See numpy.var.
+    double variance(int ddof = 0) const { return M2 / (count - ddof); }
+    /// @brief Returns the standard deviation.
+    /// @param ddof Delta degree of freedom. See numpy.std.
+    double stddev(int ddof = 0) const { return std::sqrt(variance(ddof)); }
+    /// @brief Returns the skewness.
+    double skewness() const {
+        static_assert(order >= 3, "REQUIRES MOMENTS OF ORDER 3");
+        return std::sqrt(count) * M3 / std::pow(M2, 1.5);
+    }
+    /// @brief Returns the excess kurtosis.
+    double kurtosis() const {
+        static_assert(order >= 4, "REQUIRES MOMENTS OF ORDER 4");
+        return count * M4 / (M2 * M2) - 3.;
+    }
+
+private:
+    // push the values in blocks, with the NaNs removed if skip_nan
+    template <bool skip_nan, typename Derived>
+    Moments &push_blocks(const Eigen::DenseBase<Derived> &m) {
+        using Eigen::Index;
+        constexpr Index block_size = 256;
+        Eigen::Array<double, block_size, 1> buf;
+        const auto &d = m.derived();
+        // run along the longer dimension
+        const bool along_rows = d.rows() >= d.cols();
+        const auto n_outer = along_rows ? d.cols() : d.rows();
+        const auto n_inner = along_rows ? d.rows() : d.cols();
+        for (Index j = 0; j < n_outer; ++j) {
+            for (Index i = 0; i < n_inner; i += block_size) {
+                auto n = std::min(block_size, n_inner - i);
+                auto b = buf.head(n);
+                if (along_rows) {
+                    b = d.block(i, j, n, 1).template cast<double>();
+                } else {
+                    b = d.block(j, i, 1, n).transpose().template cast<double>();
+                }
+                if constexpr (skip_nan) {
+                    auto k = internal::nancompact_inplace(b);
+                    if (k > 0) {
+                        merge(from_block(buf.head(k)));
+                    }
+                } else {
+                    merge(from_block(b));
+                }
+            }
+        }
+        return *this;
+    }
+
+    // two-pass moments of block in cache
+    template <typename Block> static Moments from_block(const Block &b) {
+        Moments mom{static_cast<double>(b.size()), b.mean()};
+        if (b.size() > 0) {
+            auto dev = b - mom.mean;
+            mom.M2 = dev.square().sum();
+            if constexpr (order >= 3) {
+                mom.M3 = dev.cube().sum();
+            }
+            if constexpr (order >= 4) {
+                mom.M4 = dev.square().square().sum();
+            }
+        }
+        return mom;
+    }
+};
+
+/**
+ * @brief Return the moments of \p m.
+ * @see Moments
+ */
+template <int order = 2, typename Derived,
+          typename = std::enable_if_t<
+              std::is_arithmetic_v<typename Derived::Scalar>>>
+auto moments(const Eigen::DenseBase<Derived> &m) {
+    Moments<order> mom{};
+    return mom.push(m);
+}
+
+/**
+ * @brief Return the moments of \p m, computed in parallel with \p ex.
+ * The data are split into slices along the longer dimension, of which the
+ * moments are merged.
+ * @param slice_size The approximate number of values per slice.
+ * @see Moments
+ */
+template <int order = 2, typename Derived,
+          typename = std::enable_if_t<
+              std::is_arithmetic_v<typename Derived::Scalar>>>
+auto moments(const grppi::dynamic_execution &ex,
+             const Eigen::DenseBase<Derived> &m,
+             Eigen::Index slice_size = 1 << 16) {
+    using Eigen::Index;
+    const auto &d = m.derived();
+    const bool split_cols = d.cols() >= d.rows();
+    const auto n = split_cols ? d.cols() : d.rows();
+    const auto n_per_outer =
+        std::max<Index>(split_cols ? d.rows() : d.cols(), 1);
+    const auto size = std::max<Index>(slice_size / n_per_outer, 1);
+    auto slices = container_utils::views::iota((n + size - 1) / size);
+    return grppi::map_reduce(
+        ex, slices.begin(), slices.end(), Moments<order>{},
+        [&](Index i) {
+            auto begin = i * size;
+            auto len = std::min(size, n - begin);
+            if (split_cols) {
+                return moments<order>(d.middleCols(begin, len));
+            }
+            return moments<order>(d.middleRows(begin, len));
+        },
+        std::plus<>{});
+}
+
 /**
  * @brief Return mean and stddev.
+ * The moments are computed in a single pass.
  * @param m The vector for which the mean and stddev are calculated.
  * @param ddof Delta degree of freedom. See numpy.std.
- * @note If \p m is an expression, it is evaluated twice.
+ * @see Moments
  */
 template <typename Derived, typename = std::enable_if_t<
                                 std::is_arithmetic_v<typename Derived::Scalar>>>
 auto meanstd(const Eigen::DenseBase<Derived> &m, int ddof = 0) {
-    auto mean_ = mean(m.derived());
-    auto size = static_cast<double>(m.size());
-    auto std =
-        std::sqrt((m.derived().array().template cast<decltype(mean_)>() - mean_)
-                      .square()
-                      .sum() /
-                  (size - ddof));
-    return std::make_pair(mean_, std);
+    auto mom = moments(m.derived());
+    return std::make_pair(mom.mean, mom.stddev(ddof));
+}
+
+/**
+ * @brief Return mean and stddev, computed in parallel with \p ex.
+ * @see meanstd
+ */
+template <typename Derived, typename = std::enable_if_t<
+                                std::is_arithmetic_v<typename Derived::Scalar>>>
+auto meanstd(const grppi::dynamic_execution &ex,
+             const Eigen::DenseBase<Derived> &m, int ddof = 0) {
+    auto mom = moments(ex, m.derived());
+    return std::make_pair(mom.mean, mom.stddev(ddof));
+}
+
+namespace internal {
+
+/// Median selection networks of small odd sizes.
+/// Each pair (i, j) orders the values i and j such that the median ends up
+/// at the middle index.
+template <Eigen::Index size> struct median_network : std::false_type {};
+
+template <> struct median_network<3> : std::true_type {
+    static constexpr std::pair<int, int> pairs[] = {{0, 1}, {1, 2}, {0, 1}};
+};
+
+template <> struct median_network<5> : std::true_type {
+    static constexpr std::pair<int, int> pairs[] = {
+        {0, 1}, {3, 4}, {0, 3}, {1, 4}, {1, 2}, {2, 3}, {1, 2}};
+};
+
+template <> struct median_network<7> : std::true_type {
+    static constexpr std::pair<int, int> pairs[] = {
+        {0, 5}, {0, 3}, {1, 6}, {2, 4}, {0, 1}, {3, 5}, {2, 6},
+        {2, 3}, {3, 6}, {4, 5}, {1, 4}, {1, 3}, {3, 4}};
+};
+
+template <> struct median_network<9> : std::true_type {
+    static constexpr std::pair<int, int> pairs[] = {
+        {1, 2}, {4, 5}, {7, 8}, {0, 1}, {3, 4}, {6, 7}, {1, 2},
+        {4, 5}, {7, 8}, {0, 3}, {5, 8}, {4, 7}, {3, 6}, {1, 4},
+        {2, 5}, {4, 7}, {2, 4}, {4, 6}, {2, 4}};
+};
+
+// order v[i] and v[j], for both scalars and Eigen arrays
+template <typename T> void median_network_sort(T &a, T &b) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        auto lo = std::min(a, b);
+        b = std::max(a, b);
+        a = lo;
+    } else {
+        T lo = a.min(b);
+        b = a.max(b);
+        a = lo;
+    }
+}
+
+template <Eigen::Index size, typename T, std::size_t... I>
+void median_network_apply(T &v, std::index_sequence<I...>) {
+    constexpr auto &pairs = median_network<size>::pairs;
+    (median_network_sort(v[pairs[I].first], v[pairs[I].second]), ...);
+}
+
+// run the network on the array of values v, of which the median is at
+// the middle index afterwards
+template <Eigen::Index size, typename T> void median_network_apply(T &v) {
+    median_network_apply<size>(
+        v, std::make_index_sequence<
+               std::size(median_network<size>::pairs)>{});
+}
+
+// median of the values of m by the network of size m.size()
+template <Eigen::Index size, typename Derived>
+auto median_network_select(const Eigen::DenseBase<Derived> &m) {
+    std::array<typename Derived::Scalar, size> v;
+    for (Eigen::Index i = 0; i < size; ++i) {
+        v[i] = m.derived().coeff(i);
+    }
+    median_network_apply<size>(v);
+    return v[size / 2];
+}
+
+// type of the workspace for the median and median absolute deviation of
+// values of Scalar type. The deviations from the median are not integral
+// in general, so integral types use double
+template <typename Scalar>
+using median_workspace_t =
+    std::conditional_t<std::is_floating_point_v<Scalar>, Scalar, double>;
+
+// median of the values in v, which are reordered
+template <typename T> auto median_inplace(std::vector<T> &v) {
+    auto n = v.size() / 2;
+    std::nth_element(v.begin(), v.begin() + n, v.end());
+    if (v.size() % 2) {
+        return v[n] * 1.0; // promote to double
+    }
+    // even sized vector -> average the two middle values
+    auto max_it = std::max_element(v.begin(), v.begin() + n);
+    return (*max_it + v[n]) / 2.0;
 }
 
+} // namespace internal
+
 /**
  * @brief Return median
+ * For vectors of compile-time size 3, 5, 7, or 9, the median is selected
+ * with a sorting network.
  * @note Promotes to double.
  */
 template <typename Derived, typename = std::enable_if_t<
                                 std::is_arithmetic_v<typename Derived::Scalar>>>
 auto median(const Eigen::DenseBase<Derived> &m) {
+    if constexpr (internal::median_network<Derived::SizeAtCompileTime>::value) {
+        return internal::median_network_select<Derived::SizeAtCompileTime>(
+                   m.derived()) *
+               1.0; // promote to double
+    }
     // copy to a std vector for sort
     auto v = eigen_utils::tostd(m);
     auto n = v.size() / 2;
@@ -150,6 +469,93 @@ template <typename Derived> auto medmad(const Eigen::DenseBase<Derived> &m) {
             (m.derived().array().template cast<decltype(med)>() - med).abs()));
 }
 
+/**
+ * @brief Return median, using \p workspace as the buffer for sort.
+ * The workspace is resized to the size of \p m, and can be reused among
+ * calls to avoid the allocation.
+ * @tparam T Floating point type, so that the values are not truncated.
+ * @note Promotes to double.
+ */
+template <typename Derived, typename T,
+          typename = std::enable_if_t<
+              std::is_arithmetic_v<typename Derived::Scalar>>>
+auto median(const Eigen::DenseBase<Derived> &m, std::vector<T> &workspace) {
+    static_assert(std::is_floating_point_v<T>,
+                  "MEDIAN WORKSPACE HAS TO BE FLOATING POINT");
+    auto &v = workspace;
+    v.resize(static_cast<std::size_t>(m.size()));
+    Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>>(
+        v.data(), m.rows(), m.cols()) = m.derived().template cast<T>();
+    return internal::median_inplace(v);
+}
+
+/**
+ * @brief Return median absolute deviation, using \p workspace as the buffer
+ * for sort.
+ * @tparam T Floating point type, to hold the deviations from the median.
+ * @see median
+ */
+template <typename Derived, typename T>
+auto medmad(const Eigen::DenseBase<Derived> &m, std::vector<T> &workspace) {
+    static_assert(std::is_floating_point_v<T>,
+                  "MEDMAD WORKSPACE HAS TO BE FLOATING POINT");
+    auto med = median(m, workspace);
+    return std::make_pair(
+        med,
+        median(
+            (m.derived().array().template cast<decltype(med)>() - med).abs(),
+            workspace));
+}
+
+/**
+ * @brief Copy the non-NaN values of \p m to \p buffer.
+ * The values are copied in column-major order, in blocks that are copied
+ * vectorized, and compacted without branching if they contain NaN. The buffer
+ * is resized to the number of non-NaN values, and can be reused among calls
+ * to avoid the allocation.
+ * @return Eigen::Map of \p buffer.
+ */
+template <typename Derived, typename T>
+auto nancompact(const Eigen::DenseBase<Derived> &m, std::vector<T> &buffer) {
+    using Eigen::Index;
+    constexpr Index block_size = 256;
+    const auto &d = m.derived();
+    buffer.resize(static_cast<std::size_t>(d.size()));
+    auto out = eigen_utils::asvec(buffer);
+    Index k = 0;
+    for (Index j = 0; j < d.cols(); ++j) {
+        for (Index i = 0; i < d.rows(); i += block_size) {
+            auto n = std::min(block_size, d.rows() - i);
+            auto b = out.segment(k, n);
+            b = d.block(i, j, n, 1).template cast<T>();
+            k += internal::nancompact_inplace(b);
+        }
+    }
+    buffer.resize(static_cast<std::size_t>(k));
+    return eigen_utils::asvec(buffer);
+}
+
+/**
+ * @brief Return median with nan excluded, using \p workspace as the buffer
+ * for sort.
+ * @tparam T Floating point type, so that the values are not truncated.
+ * @see nancompact
+ * @note Promotes to double.
+ */
+template <typename Derived, typename T,
+          typename = std::enable_if_t<
+              std::is_arithmetic_v<typename Derived::Scalar>>>
+double nanmedian(const Eigen::DenseBase<Derived> &m,
+                 std::vector<T> &workspace) {
+    static_assert(std::is_floating_point_v<T>,
+                  "NANMEDIAN WORKSPACE HAS TO BE FLOATING POINT");
+    nancompact(m, workspace);
+    if (workspace.empty()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return internal::median_inplace(workspace);
+}
+
 /**
  * @brief Return median with nan excluded
  * @note Promotes to double.
@@ -158,27 +564,8 @@ template <
     typename Derived,
     typename = std::enable_if_t<std::is_arithmetic_v<typename Derived::Scalar>>>
 auto nanmedian(const Eigen::DenseBase<Derived> &m) {
-    // copy to a std vector for sort
-    using Scalar = typename Derived::Scalar;
-    std::vector<Scalar> v;
-    v.reserve(m.size());
-    for (Eigen::Index i = 0; i < m.size(); ++i) {
-        if (!std::isnan(m.coeff(i))) {
-            v.push_back(m.coeff(i));
-        }
-    }
-    if (v.size() == 0) {
-        return std::numeric_limits<Scalar>::quiet_NaN();
-    }
-    auto n = v.size() / 2;
-    std::nth_element(v.begin(), v.begin() + n, v.end());
-    if (v.size() % 2) {
-        return v[n] * 1.0; // promote to double
-    }
-    // even sized vector -> average the two middle values
-    auto max_it = std::max_element(v.begin(), v.begin() + n);
-    const double medf = 2.0;
-    return (*max_it + v[n]) / medf;
+    std::vector<internal::median_workspace_t<typename Derived::Scalar>> v;
+    return nanmedian(m, v);
 }
 
 /**
@@ -192,4 +579,481 @@ template <typename Derived> auto nanmedmad(const Eigen::DenseBase<Derived> &m) {
             (m.derived().array().template cast<decltype(med)>() - med).abs()));
 }
 
+/**
+ * @brief Return median absolute deviation with nan excluded, using
+ * \p workspace as the buffer for sort.
+ * @see nanmedian
+ */
+template <typename Derived, typename T>
+auto nanmedmad(const Eigen::DenseBase<Derived> &m, std::vector<T> &workspace) {
+    auto med = nanmedian(m, workspace);
+    return std::make_pair(
+        med,
+        nanmedian(
+            (m.derived().array().template cast<decltype(med)>() - med).abs(),
+            workspace));
+}
+
+/**
+ * @brief The axis along which the statistics are computed.
+ * As with Eigen colwise() and rowwise(), \ref Axis::Colwise reduces each
+ * column to one value, and \ref Axis::Rowwise reduces each row.
+ */
+enum class Axis { Colwise, Rowwise };
+
+namespace internal {
+
+// reduce along axis with func(vectorwise op), as column vector
+template <Axis axis, typename Expr, typename F>
+auto reduce_along(const Expr &expr, F &&func) {
+    if constexpr (axis == Axis::Colwise) {
+        return FWD(func)(expr.colwise()).transpose().matrix().eval();
+    } else {
+        return FWD(func)(expr.rowwise()).matrix().eval();
+    }
+}
+
+// the non-NaN mask
+template <typename Derived> auto isvalid(const Eigen::DenseBase<Derived> &m) {
+    return m.derived().array() == m.derived().array();
+}
+
+} // namespace internal
+
+// The NaN-aware reductions mask the NaNs with select, which vectorizes.
+
+/**
+ * @brief Return the number of non-NaN values.
+ */
+template <typename Derived>
+Eigen::Index nancount(const Eigen::DenseBase<Derived> &m) {
+    return internal::isvalid(m).count();
+}
+
+/**
+ * @brief Return the number of non-NaN values along \p axis.
+ */
+template <Axis axis, typename Derived>
+auto nancount(const Eigen::DenseBase<Derived> &m) {
+    return internal::reduce_along<axis>(internal::isvalid(m),
+                                        [](auto &&v) { return v.count(); });
+}
+
+/**
+ * @brief Return sum with nan excluded.
+ */
+template <typename Derived, typename = std::enable_if_t<
+                                std::is_arithmetic_v<typename Derived::Scalar>>>
+auto nansum(const Eigen::DenseBase<Derived> &m) {
+    using Scalar = typename Derived::Scalar;
+    return internal::isvalid(m).select(m.derived().array(), Scalar(0)).sum();
+}
+
+/**
+ * @brief Return sum with nan excluded along \p axis.
+ */
+template <Axis axis, typename Derived>
+auto nansum(const Eigen::DenseBase<Derived> &m) {
+    using Scalar = typename Derived::Scalar;
+    return internal::reduce_along<axis>(
+        internal::isvalid(m).select(m.derived().array(), Scalar(0)),
+        [](auto &&v) { return v.sum(); });
+}
+
+/**
+ * @brief Return mean with nan excluded.
+ * NaN is returned if all values are NaN.
+ * @note Promotes to double.
+ */
+template <typename Derived, typename = std::enable_if_t<
+                                std::is_arithmetic_v<typename Derived::Scalar>>>
+double nanmean(const Eigen::DenseBase<Derived> &m) {
+    return static_cast<double>(nansum(m)) / static_cast<double>(nancount(m));
+}
+
+/**
+ * @brief Return mean with nan excluded along \p axis.
+ * @note Promotes to double.
+ */
+template <Axis axis, typename Derived>
+auto nanmean(const Eigen::DenseBase<Derived> &m) {
+    return (nansum<axis>(m).template cast<double>().array() /
+            nancount<axis>(m).template cast<double>().array())
+        .matrix()
+        .eval();
+}
+
+/**
+ * @brief Return mean and stddev with nan excluded.
+ * The moments of the non-NaN values are computed in a single pass.
+ * NaN is returned if all values are NaN.
+ * @param ddof Delta degree of freedom. See numpy.nanstd.
+ * @see Moments::nanpush
+ */
+template <typename Derived, typename = std::enable_if_t<
+                                std::is_arithmetic_v<typename Derived::Scalar>>>
+auto nanmeanstd(const Eigen::DenseBase<Derived> &m, int ddof = 0) {
+    Moments<> mom{};
+    mom.nanpush(m);
+    if (mom.count == 0) {
+        constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+        return std::make_pair(nan, nan);
+    }
+    return std::make_pair(mom.mean, mom.stddev(ddof));
+}
+
+/**
+ * @brief Return mean and stddev with nan excluded along \p axis.
+ * @see nanmeanstd
+ */
+template <Axis axis, typename Derived>
+auto nanmeanstd(const Eigen::DenseBase<Derived> &m, int ddof = 0) {
+    const auto &d = m.derived();
+    const auto n = axis == Axis::Colwise ? d.cols() : d.rows();
+    Eigen::VectorXd mean_(n);
+    Eigen::VectorXd std_(n);
+    for (Eigen::Index i = 0; i < n; ++i) {
+        if constexpr (axis == Axis::Colwise) {
+            std::tie(mean_.coeffRef(i), std_.coeffRef(i)) =
+                nanmeanstd(d.col(i), ddof);
+        } else {
+            std::tie(mean_.coeffRef(i), std_.coeffRef(i)) =
+                nanmeanstd(d.row(i), ddof);
+        }
+    }
+    return std::make_pair(std::move(mean_), std::move(std_));
+}
+
+/**
+ * @brief Return stddev with nan excluded.
+ * @see nanmeanstd
+ */
+template <typename Derived, typename = std::enable_if_t<
+                                std::is_arithmetic_v<typename Derived::Scalar>>>
+double nanstd(const Eigen::DenseBase<Derived> &m, int ddof = 0) {
+    return nanmeanstd(m, ddof).second;
+}
+
+/**
+ * @brief Return stddev with nan excluded along \p axis.
+ * @see nanmeanstd
+ */
+template <Axis axis, typename Derived>
+auto nanstd(const Eigen::DenseBase<Derived> &m, int ddof = 0) {
+    return nanmeanstd<axis>(m, ddof).second;
+}
+
+namespace internal {
+
+// nanmin and nanmax, with op = -1 for min and 1 for max
+template <int op, typename Derived>
+auto nanextremum(const Eigen::DenseBase<Derived> &m) {
+    using Scalar = typename Derived::Scalar;
+    using limits = std::numeric_limits<Scalar>;
+    constexpr auto fill = op < 0 ? limits::max() : limits::lowest();
+    if (nancount(m) == 0) {
+        return limits::quiet_NaN();
+    }
+    auto masked = isvalid(m).select(m.derived().array(), fill);
+    if constexpr (op < 0) {
+        return masked.minCoeff();
+    } else {
+        return masked.maxCoeff();
+    }
+}
+
+template <int op, Axis axis, typename Derived>
+auto nanextremum(const Eigen::DenseBase<Derived> &m) {
+    using Scalar = typename Derived::Scalar;
+    using limits = std::numeric_limits<Scalar>;
+    constexpr auto fill = op < 0 ? limits::max() : limits::lowest();
+    auto result = reduce_along<axis>(
+        isvalid(m).select(m.derived().array(), fill), [](auto &&v) {
+            if constexpr (op < 0) {
+                return v.minCoeff();
+            } else {
+                return v.maxCoeff();
+            }
+        });
+    result = (nancount<axis>(m).array() > 0)
+                 .select(result, limits::quiet_NaN());
+    return result;
+}
+
+} // namespace internal
+
+/**
+ * @brief Return min with nan excluded.
+ * NaN is returned if all values are NaN.
+ */
+template <typename Derived, typename = std::enable_if_t<
+                                std::is_arithmetic_v<typename Derived::Scalar>>>
+auto nanmin(const Eigen::DenseBase<Derived> &m) {
+    return internal::nanextremum<-1>(m);
+}
+
+/**
+ * @brief Return min with nan excluded along \p axis.
+ */
+template <Axis axis, typename Derived>
+auto nanmin(const Eigen::DenseBase<Derived> &m) {
+    return internal::nanextremum<-1, axis>(m);
+}
+
+/**
+ * @brief Return max with nan excluded.
+ * NaN is returned if all values are NaN.
+ */
+template <typename Derived, typename = std::enable_if_t<
+                                std::is_arithmetic_v<typename Derived::Scalar>>>
+auto nanmax(const Eigen::DenseBase<Derived> &m) {
+    return internal::nanextremum<1>(m);
+}
+
+/**
+ * @brief Return max with nan excluded along \p axis.
+ */
+template <Axis axis, typename Derived>
+auto nanmax(const Eigen::DenseBase<Derived> &m) {
+    return internal::nanextremum<1, axis>(m);
+}
+
+namespace internal {
+
+// number of slices along axis
+template <Axis axis, typename Derived>
+Eigen::Index n_slices(const Eigen::DenseBase<Derived> &m) {
+    return axis == Axis::Colwise ? m.cols() : m.rows();
+}
+
+// the i-th slice along axis
+template <Axis axis, typename Derived>
+auto slice(const Eigen::DenseBase<Derived> &m, Eigen::Index i) {
+    if constexpr (axis == Axis::Colwise) {
+        return m.derived().col(i);
+    } else {
+        return m.derived().row(i);
+    }
+}
+
+// the output of size n
+template <typename DerivedOut>
+auto &output_of_size(Eigen::DenseBase<DerivedOut> const &output_,
+                     Eigen::Index n) {
+    auto &output =
+        const_cast<Eigen::DenseBase<DerivedOut> &>(output_).derived();
+    if (output.size() == 0) {
+        output.resize(n);
+    }
+    if (output.size() != n) {
+        throw std::runtime_error(
+            fmt::format("output data has incorrect size {}, expect {}",
+                        output.size(), n));
+    }
+    return output;
+}
+
+// run func(begin, end) on the blocks of slices along axis
+// the slices are independent and of equal cost, so the blocks are sized to
+// balance the load among the threads of the budget
+template <Axis axis, typename Derived, typename F>
+void for_each_slice_block(const grppi::dynamic_execution &ex,
+                          const Eigen::DenseBase<Derived> &m, F &&func) {
+    const auto n = n_slices<axis>(m);
+    const auto n_blocks = 4 * grppiex::Budget::instance().share();
+    auto grain = grppiex::Grain::fixed((n + n_blocks - 1) / n_blocks);
+    grppiex::for_each_block(ex, n, FWD(func), grain);
+}
+
+} // namespace internal
+
+/**
+ * @brief Compute mean along \p axis in parallel with \p ex.
+ * The results are written to \p output.
+ * @see mean
+ */
+template <Axis axis, typename Derived, typename DerivedOut>
+void mean(const grppi::dynamic_execution &ex,
+          const Eigen::DenseBase<Derived> &m,
+          Eigen::DenseBase<DerivedOut> const &output_) {
+    auto &output =
+        internal::output_of_size(output_, internal::n_slices<axis>(m));
+    const auto &d = m.derived();
+    internal::for_each_slice_block<axis>(ex, m, [&](auto begin, auto end) {
+        auto out = output.segment(begin, end - begin).array();
+        if constexpr (axis == Axis::Colwise) {
+            out = d.middleCols(begin, end - begin)
+                      .template cast<double>()
+                      .colwise()
+                      .sum()
+                      .transpose()
+                      .array() /
+                  static_cast<double>(d.rows());
+        } else {
+            out = d.middleRows(begin, end - begin)
+                      .template cast<double>()
+                      .rowwise()
+                      .sum()
+                      .array() /
+                  static_cast<double>(d.cols());
+        }
+    });
+}
+
+/**
+ * @brief Return mean along \p axis, computed in parallel with \p ex.
+ * @note Promotes to double.
+ */
+template <Axis axis, typename Derived>
+auto mean(const grppi::dynamic_execution &ex,
+          const Eigen::DenseBase<Derived> &m) {
+    Eigen::VectorXd output(internal::n_slices<axis>(m));
+    mean<axis>(ex, m, output);
+    return output;
+}
+
+/**
+ * @brief Return mean along \p axis.
+ * @note Promotes to double.
+ */
+template <Axis axis, typename Derived>
+auto mean(const Eigen::DenseBase<Derived> &m) {
+    return mean<axis>(grppiex::shared_ex("seq"), m);
+}
+
+/**
+ * @brief Compute mean and stddev along \p axis in parallel with \p ex.
+ * The moments of each slice are computed in a single pass, and the results
+ * are written to \p mean_output and \p std_output.
+ * @see meanstd
+ */
+template <Axis axis, typename Derived, typename DerivedMean,
+          typename DerivedStd>
+void meanstd(const grppi::dynamic_execution &ex,
+             const Eigen::DenseBase<Derived> &m,
+             Eigen::DenseBase<DerivedMean> const &mean_output_,
+             Eigen::DenseBase<DerivedStd> const &std_output_, int ddof = 0) {
+    const auto n = internal::n_slices<axis>(m);
+    auto &mean_output = internal::output_of_size(mean_output_, n);
+    auto &std_output = internal::output_of_size(std_output_, n);
+    internal::for_each_slice_block<axis>(ex, m, [&](auto begin, auto end) {
+        for (auto i = begin; i < end; ++i) {
+            auto mom = moments(internal::slice<axis>(m, i));
+            mean_output.coeffRef(i) = mom.mean;
+            std_output.coeffRef(i) = mom.stddev(ddof);
+        }
+    });
+}
+
+/**
+ * @brief Return mean and stddev along \p axis, computed in parallel with
+ * \p ex.
+ */
+template <Axis axis, typename Derived>
+auto meanstd(const grppi::dynamic_execution &ex,
+             const Eigen::DenseBase<Derived> &m, int ddof = 0) {
+    const auto n = internal::n_slices<axis>(m);
+    Eigen::VectorXd mean_output(n);
+    Eigen::VectorXd std_output(n);
+    meanstd<axis>(ex, m, mean_output, std_output, ddof);
+    return std::make_pair(std::move(mean_output), std::move(std_output));
+}
+
+/**
+ * @brief Return mean and stddev along \p axis.
+ */
+template <Axis axis, typename Derived>
+auto meanstd(const Eigen::DenseBase<Derived> &m, int ddof = 0) {
+    return meanstd<axis>(grppiex::shared_ex("seq"), m, ddof);
+}
+
+/**
+ * @brief Compute median along \p axis in parallel with \p ex.
+ * Each block of slices reuses one workspace for sort, and the results are
+ * written to \p output.
+ * @see median
+ */
+template <Axis axis, typename Derived, typename DerivedOut>
+void median(const grppi::dynamic_execution &ex,
+            const Eigen::DenseBase<Derived> &m,
+            Eigen::DenseBase<DerivedOut> const &output_) {
+    auto &output =
+        internal::output_of_size(output_, internal::n_slices<axis>(m));
+    internal::for_each_slice_block<axis>(ex, m, [&](auto begin, auto end) {
+        std::vector<internal::median_workspace_t<typename Derived::Scalar>>
+            workspace;
+        for (auto i = begin; i < end; ++i) {
+            output.coeffRef(i) =
+                median(internal::slice<axis>(m, i), workspace);
+        }
+    });
+}
+
+/**
+ * @brief Return median along \p axis, computed in parallel with \p ex.
+ * @note Promotes to double.
+ */
+template <Axis axis, typename Derived>
+auto median(const grppi::dynamic_execution &ex,
+            const Eigen::DenseBase<Derived> &m) {
+    Eigen::VectorXd output(internal::n_slices<axis>(m));
+    median<axis>(ex, m, output);
+    return output;
+}
+
+/**
+ * @brief Return median along \p axis.
+ * @note Promotes to double.
+ */
+template <Axis axis, typename Derived>
+auto median(const Eigen::DenseBase<Derived> &m) {
+    return median<axis>(grppiex::shared_ex("seq"), m);
+}
+
+/**
+ * @brief Compute median and median absolute deviation along \p axis in
+ * parallel with \p ex.
+ * The results are written to \p med_output and \p mad_output.
+ * @see medmad
+ */
+template <Axis axis, typename Derived, typename DerivedMed, typename DerivedMad>
+void medmad(const grppi::dynamic_execution &ex,
+            const Eigen::DenseBase<Derived> &m,
+            Eigen::DenseBase<DerivedMed> const &med_output_,
+            Eigen::DenseBase<DerivedMad> const &mad_output_) {
+    const auto n = internal::n_slices<axis>(m);
+    auto &med_output = internal::output_of_size(med_output_, n);
+    auto &mad_output = internal::output_of_size(mad_output_, n);
+    internal::for_each_slice_block<axis>(ex, m, [&](auto begin, auto end) {
+        std::vector<internal::median_workspace_t<typename Derived::Scalar>>
+            workspace;
+        for (auto i = begin; i < end; ++i) {
+            std::tie(med_output.coeffRef(i), mad_output.coeffRef(i)) =
+                medmad(internal::slice<axis>(m, i), workspace);
+        }
+    });
+}
+
+/**
+ * @brief Return median and median absolute deviation along \p axis,
+ * computed in parallel with \p ex.
+ */
+template <Axis axis, typename Derived>
+auto medmad(const grppi::dynamic_execution &ex,
+            const Eigen::DenseBase<Derived> &m) {
+    const auto n = internal::n_slices<axis>(m);
+    Eigen::VectorXd med_output(n);
+    Eigen::VectorXd mad_output(n);
+    medmad<axis>(ex, m, med_output, mad_output);
+    return std::make_pair(std::move(med_output), std::move(mad_output));
+}
+
+/**
+ * @brief Return median and median absolute deviation along \p axis.
+ */
+template <Axis axis, typename Derived>
+auto medmad(const Eigen::DenseBase<Derived> &m) {
+    return medmad<axis>(grppiex::shared_ex("seq"), m);
+}
+
 } // namespace alg
@@ -3,6 +3,8 @@
 #include "../container.h"
 #include "../eigen.h"
 #include "../grppiex.h"
+#include "../grppiex/grain.h"
+#include "ei_medfilt.h"
 #include "ei_stats.h"
 
 namespace alg {
@@ -13,7 +15,7 @@ auto lacosmic1d(const Eigen::DenseBase<DerivedA> &data,
                 const Eigen::DenseBase<DerivedC> &mask, double sigclip = 4.5,
                 double sigfrac = 0.3, double objlim = 5., int maxiter = 4,
                 double fill_value = 0.,
-                const grppi::dynamic_execution &ex = grppiex::dyn_ex()) {
+                const grppi::dynamic_execution &ex = grppiex::shared_ex()) {
     static_assert(DerivedA::IsVectorAtCompileTime, "EXPECT VECTOR");
     constexpr auto block_size = 2;
     const auto sigcliplow = sigclip * sigfrac;
@@ -36,6 +38,14 @@ auto lacosmic1d(const Eigen::DenseBase<DerivedA> &data,
 
     constexpr auto laplace_size = 3;
 
+    // the per-element work is tiny, so the tasks are coalesced in blocks
+    // with block sizes tuned over the first iterations, separately for each
+    // loop as the per-element costs differ
+    auto sample_grain = grppiex::Grain::auto_();
+    auto rebin_grain = grppiex::Grain::auto_();
+    auto laplace_grain = grppiex::Grain::auto_();
+    auto dilate_grain = grppiex::Grain::auto_();
+
     auto border_patches = [](const auto &data, Index window, auto &&patchfunc) {
         const auto n = data.size();
         const auto i0 = (window - 1) / 2;
@@ -74,20 +84,22 @@ auto lacosmic1d(const Eigen::DenseBase<DerivedA> &data,
             });
     };
     auto windowed_apply = [&](const auto &data, auto &&func, Index size,
-                              auto &output, auto &&borderfunc) {
+                              auto &output, auto &&borderfunc,
+                              grppiex::Grain &grain) {
         auto valid_segment = [](auto &data, Index window) {
             const auto size = data.size();
             assert(size >= window);
             const auto i0 = (window - 1) / 2;
             return data.segment(i0, size - window + 1);
         };
-        auto valid_indices = container_utils::index(valid_segment(data, size));
         assert(output.size() == data.size());
-        grppi::map(ex, valid_indices, valid_indices, [&](auto i) {
-            FWD(func)
-            (data.segment(i, size), valid_segment(output, size).coeffRef(i));
-            return i;
-        });
+        auto valid_output = valid_segment(output, size);
+        grppiex::for_each_index(
+            ex, valid_output.size(),
+            [&](auto i) {
+                FWD(func)(data.segment(i, size), valid_output.coeffRef(i));
+            },
+            grain);
         auto patches = borderfunc(data, size);
         auto border_indices = container_utils::index(patches.first.cols());
         grppi::map(ex, border_indices, border_indices, [&](auto i) {
@@ -96,56 +108,55 @@ auto lacosmic1d(const Eigen::DenseBase<DerivedA> &data,
             return i;
         });
     };
-    auto medfilt = [&windowed_apply, &border_patches_mirror](const auto &data,
-                                                             Index size) {
-        typename DECAY(data)::PlainObject output(data.size());
-        windowed_apply(
-            data,
-            [](const auto &patch, auto &output) {
-                output = alg::median(patch);
-            },
-            size, output, border_patches_mirror);
-        return output;
+    // the window sizes are compile-time constants to use the median networks.
+    // The border windows are mirror padded per position, unlike the shared
+    // patch of border_patches_mirror
+    auto medfilt = [&ex](const auto &data, auto size) {
+        return alg::medfilt1d<decltype(size)::value, BorderMode::Mirror>(ex,
+                                                                       data);
     };
-    auto dilate = [&windowed_apply, &border_patches_nearest](const auto &data,
-                                                             Index size) {
+    auto dilate = [&windowed_apply, &border_patches_nearest,
+                   &dilate_grain](const auto &data, Index size) {
         typename DECAY(data)::PlainObject output(data.size());
         windowed_apply(
             data, [](const auto &patch, auto &output) { output = patch.sum(); },
-            size, output, border_patches_nearest);
+            size, output, border_patches_nearest, dilate_grain);
         return output;
     };
-    auto indices = container_utils::index(n);
-    auto sampled_indices = container_utils::index(n_sampled);
     for (Index it = 0; it < maxiter; ++it) {
         logging::scoped_timeit _0("lacosmic1d iter");
-        grppi::map(ex, indices, indices, [&](auto i) {
-            sampled_data.segment(i * block_size, block_size)
-                .setConstant(cleaned_data.coeff(i) / block_size);
-            return i;
-        });
+        grppiex::for_each_index(
+            ex, n,
+            [&](auto i) {
+                sampled_data.segment(i * block_size, block_size)
+                    .setConstant(cleaned_data.coeff(i) / block_size);
+            },
+            sample_grain);
         windowed_apply(
             sampled_data,
             [](const auto &patch, auto &output) {
                 // [-1, 2, -1]
                 output = patch.coeff(1) * 2. - patch.coeff(0) - patch.coeff(1);
             },
-            laplace_size, convolved_data, border_patches_mirror);
-        grppi::map(ex, indices, indices, [&](auto i) {
-            laplacian_data.coeffRef(i) =
-                convolved_data.segment(i * block_size, block_size).sum();
-            return i;
-        });
+            laplace_size, convolved_data, border_patches_mirror,
+            laplace_grain);
+        grppiex::for_each_index(
+            ex, n,
+            [&](auto i) {
+                laplacian_data.coeffRef(i) =
+                    convolved_data.segment(i * block_size, block_size).sum();
+            },
+            rebin_grain);
         auto snr =
             laplacian_data
                 .cwiseQuotient(double(block_size) * uncertainty.derived())
                 .array()
                 .eval();
         // remove large structure
-        snr -= medfilt(snr, 5);
+        snr -= medfilt(snr, std::integral_constant<Index, 5>{});
         // fine structure
-        auto m3 = medfilt(cleaned_data, 3);
-        auto fine = (m3 - medfilt(m3, 7))
+        auto m3 = medfilt(cleaned_data, std::integral_constant<Index, 3>{});
+        auto fine = (m3 - medfilt(m3, std::integral_constant<Index, 7>{}))
                         .cwiseQuotient(uncertainty.derived())
                         .array()
                         .eval();
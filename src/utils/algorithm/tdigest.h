@@ -0,0 +1,268 @@
+#pragma once
+
+#include "../eigen.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace alg {
+
+/**
+ * @brief Mergeable sketch of quantiles.
+ * This implements the merging t-digest of Dunning & Ertl: the values are
+ * summarized by weighted centroids, of which the number is bounded by about
+ * the compression parameter, so memory stays bounded for any number of
+ * values. The centroids near the tails are kept small, so that the extreme
+ * quantiles have good relative accuracy.
+ * The digests of separate chunks of data can be merged with operator+, so
+ * the type can be used as the accumulator of grppi::map_reduce, and it is
+ * serializable, so it can be reduced across MPI ranks with
+ * mpi_utils::map_reduce.
+ * @note NaN values are skipped.
+ * @note The const queries merge the pending values into the centroids in
+ * place, so they are not safe to call concurrently on a digest with
+ * pending values. Call \ref compress before sharing the digest.
+ */
+class TDigest {
+public:
+    /// @brief Weighted mean of values.
+    struct Centroid {
+        double mean{0};
+        double weight{0};
+    };
+
+    /// @param compression Bound of the number of centroids. Larger value
+    /// gives better accuracy.
+    explicit TDigest(double compression = 100.) : m_compression{compression} {
+        if (!(compression > 0.)) {
+            throw std::runtime_error(fmt::format(
+                "invalid tdigest compression {}", compression));
+        }
+    }
+
+    /// @brief Returns the compression parameter.
+    double compression() const { return m_compression; }
+    /// @brief Returns the total weight of the values.
+    double count() const { return m_count; }
+    /// @brief Returns true if no value has been inserted.
+    bool empty() const { return m_count == 0.; }
+    /// @brief Returns the min value.
+    double min() const { return m_min; }
+    /// @brief Returns the max value.
+    double max() const { return m_max; }
+
+    /// @brief Returns the centroids, with pending values merged.
+    const std::vector<Centroid> &centroids() const {
+        compress();
+        return m_centroids;
+    }
+
+    /// @brief Insert value \p x of weight \p w.
+    TDigest &insert(double x, double w = 1.) {
+        if (std::isnan(x) || !(w > 0.)) {
+            return *this;
+        }
+        // allocated on first use, so that empty digests are cheap to copy
+        if (m_buffer.capacity() == 0) {
+            m_buffer.reserve(buffer_size());
+        }
+        m_buffer.push_back({x, w});
+        m_count += w;
+        m_min = std::min(m_min, x);
+        m_max = std::max(m_max, x);
+        if (m_buffer.size() >= buffer_size()) {
+            compress();
+        }
+        return *this;
+    }
+
+    /// @brief Insert the values of \p m.
+    template <typename Derived>
+    TDigest &insert(const Eigen::DenseBase<Derived> &m) {
+        const auto &d = m.derived();
+        for (Eigen::Index j = 0; j < d.cols(); ++j) {
+            for (Eigen::Index i = 0; i < d.rows(); ++i) {
+                insert(static_cast<double>(d.coeff(i, j)));
+            }
+        }
+        return *this;
+    }
+
+    /// @brief Merge with digest \p other.
+    /// @throws std::runtime_error if the compressions differ.
+    TDigest &merge(const TDigest &other) {
+        if (other.m_compression != m_compression) {
+            throw std::runtime_error(fmt::format(
+                "cannot merge tdigest of compression {} into {}",
+                other.m_compression, m_compression));
+        }
+        if (other.empty()) {
+            return *this;
+        }
+        compress();
+        m_buffer.insert(m_buffer.end(), other.m_centroids.begin(),
+                        other.m_centroids.end());
+        m_buffer.insert(m_buffer.end(), other.m_buffer.begin(),
+                        other.m_buffer.end());
+        m_count += other.m_count;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+        compress();
+        return *this;
+    }
+
+    friend TDigest operator+(TDigest lhs, const TDigest &rhs) {
+        return std::move(lhs.merge(rhs));
+    }
+
+    /// @brief Merge the pending values into the centroids.
+    void compress() const {
+        if (m_buffer.empty()) {
+            return;
+        }
+        m_buffer.insert(m_buffer.end(), m_centroids.begin(), m_centroids.end());
+        std::sort(m_buffer.begin(), m_buffer.end(),
+                  [](const auto &lhs, const auto &rhs) {
+                      return lhs.mean < rhs.mean;
+                  });
+        m_centroids.clear();
+        auto cur = m_buffer.front();
+        double w_so_far = 0;
+        double q_limit = q_limit_of(0.);
+        for (auto it = m_buffer.begin() + 1; it != m_buffer.end(); ++it) {
+            if ((w_so_far + cur.weight + it->weight) / m_count <= q_limit) {
+                // absorb into the current centroid
+                cur.weight += it->weight;
+                cur.mean += (it->mean - cur.mean) * it->weight / cur.weight;
+            } else {
+                w_so_far += cur.weight;
+                m_centroids.push_back(cur);
+                q_limit = q_limit_of(w_so_far / m_count);
+                cur = *it;
+            }
+        }
+        m_centroids.push_back(cur);
+        m_buffer.clear();
+    }
+
+    /**
+     * @brief Returns the estimate of quantile \p q.
+     * The value is interpolated between the centroids, and between the
+     * outer centroids and the min and max values.
+     * NaN is returned if the digest is empty.
+     */
+    double quantile(double q) const {
+        compress();
+        if (empty()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        if (q <= 0.) {
+            return m_min;
+        }
+        if (q >= 1.) {
+            return m_max;
+        }
+        const auto &cs = m_centroids;
+        const auto target = q * m_count;
+        auto lerp = [](double x0, double x1, double t) {
+            return x0 + (x1 - x0) * std::clamp(t, 0., 1.);
+        };
+        // left of the first centroid center
+        if (target < cs.front().weight / 2.) {
+            return lerp(m_min, cs.front().mean,
+                        target / (cs.front().weight / 2.));
+        }
+        double w_so_far = 0;
+        for (std::size_t i = 0; i + 1 < cs.size(); ++i) {
+            const auto left = w_so_far + cs[i].weight / 2.;
+            const auto right = w_so_far + cs[i].weight + cs[i + 1].weight / 2.;
+            if (target <= right) {
+                return lerp(cs[i].mean, cs[i + 1].mean,
+                            (target - left) / (right - left));
+            }
+            w_so_far += cs[i].weight;
+        }
+        // right of the last centroid center
+        const auto left = m_count - cs.back().weight / 2.;
+        return lerp(cs.back().mean, m_max,
+                    (target - left) / (cs.back().weight / 2.));
+    }
+
+    /// @brief Returns the estimate of median.
+    double median() const { return quantile(0.5); }
+
+    /**
+     * @brief Returns the digest as bytes.
+     * The layout is the compression, count, min, max, and the number of
+     * centroids, followed by the mean and weight of the centroids.
+     */
+    std::string serialize() const {
+        const auto &cs = centroids();
+        std::string buf(header_size + cs.size() * sizeof(Centroid), '\0');
+        const double header[] = {m_compression, m_count, m_min, m_max,
+                                 static_cast<double>(cs.size())};
+        std::memcpy(buf.data(), header, header_size);
+        std::memcpy(buf.data() + header_size, cs.data(),
+                    cs.size() * sizeof(Centroid));
+        return buf;
+    }
+
+    /// @brief Returns the digest from bytes created by \ref serialize.
+    static TDigest deserialize(std::string_view buf) {
+        double header[n_header];
+        if (buf.size() < header_size) {
+            throw std::runtime_error(
+                fmt::format("invalid tdigest data size {}", buf.size()));
+        }
+        std::memcpy(header, buf.data(), header_size);
+        const auto n = static_cast<std::size_t>(header[4]);
+        if (buf.size() != header_size + n * sizeof(Centroid)) {
+            throw std::runtime_error(fmt::format(
+                "invalid tdigest data size {} for {} centroids", buf.size(),
+                n));
+        }
+        TDigest digest{header[0]};
+        digest.m_count = header[1];
+        digest.m_min = header[2];
+        digest.m_max = header[3];
+        digest.m_centroids.resize(n);
+        std::memcpy(digest.m_centroids.data(), buf.data() + header_size,
+                    n * sizeof(Centroid));
+        return digest;
+    }
+
+private:
+    static constexpr std::size_t n_header = 5;
+    static constexpr std::size_t header_size = n_header * sizeof(double);
+
+    double m_compression;
+    double m_count{0};
+    double m_min{std::numeric_limits<double>::infinity()};
+    double m_max{-std::numeric_limits<double>::infinity()};
+    // the centroids and pending values are merged lazily by the queries
+    mutable std::vector<Centroid> m_centroids;
+    // pending values not yet merged into the centroids
+    mutable std::vector<Centroid> m_buffer;
+
+    std::size_t buffer_size() const {
+        return static_cast<std::size_t>(std::ceil(m_compression * 5.));
+    }
+
+    // max quantile of the centroid starting at quantile q, from the scale
+    // function k(q) = compression / (2 pi) * asin(2q - 1)
+    double q_limit_of(double q) const {
+        constexpr double pi = 3.141592653589793;
+        const auto scale = m_compression / (2. * pi);
+        const auto k = scale * std::asin(2. * q - 1.) + 1.;
+        if (k >= scale * pi / 2.) {
+            return 1.;
+        }
+        return (std::sin(k / scale) + 1.) / 2.;
+    }
+};
+
+} // namespace alg
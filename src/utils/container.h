@@ -170,6 +170,160 @@ std::vector<std::pair<std::size_t, typename T::value_type>> enumerate(const T& v
     return ret;
 }
 
+/**
+ * @brief Lazy random-access views.
+ * The views compute the elements on access, without allocation. The views
+ * refer to the underlying containers, which have to outlive them.
+ * Iterators of a view refer to the view itself.
+ */
+namespace views {
+
+/// @brief Random-access iterator that yields \p func(i) at position i.
+template <typename Func> class IndexIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::invoke_result_t<const Func &, difference_type>;
+    using value_type = std::decay_t<reference>;
+    using pointer = void;
+
+    IndexIterator() = default;
+    IndexIterator(const Func *func, difference_type i)
+        : m_func{func}, m_i{i} {}
+
+    reference operator*() const { return (*m_func)(m_i); }
+    reference operator[](difference_type n) const { return (*m_func)(m_i + n); }
+
+    IndexIterator &operator++() {
+        ++m_i;
+        return *this;
+    }
+    IndexIterator operator++(int) { return {m_func, m_i++}; }
+    IndexIterator &operator--() {
+        --m_i;
+        return *this;
+    }
+    IndexIterator operator--(int) { return {m_func, m_i--}; }
+    IndexIterator &operator+=(difference_type n) {
+        m_i += n;
+        return *this;
+    }
+    IndexIterator &operator-=(difference_type n) {
+        m_i -= n;
+        return *this;
+    }
+    friend IndexIterator operator+(IndexIterator it, difference_type n) {
+        return it += n;
+    }
+    friend IndexIterator operator+(difference_type n, IndexIterator it) {
+        return it += n;
+    }
+    friend IndexIterator operator-(IndexIterator it, difference_type n) {
+        return it -= n;
+    }
+    friend difference_type operator-(const IndexIterator &lhs,
+                                     const IndexIterator &rhs) {
+        return lhs.m_i - rhs.m_i;
+    }
+    friend bool operator==(const IndexIterator &lhs, const IndexIterator &rhs) {
+        return lhs.m_i == rhs.m_i;
+    }
+    friend bool operator!=(const IndexIterator &lhs, const IndexIterator &rhs) {
+        return lhs.m_i != rhs.m_i;
+    }
+    friend bool operator<(const IndexIterator &lhs, const IndexIterator &rhs) {
+        return lhs.m_i < rhs.m_i;
+    }
+    friend bool operator>(const IndexIterator &lhs, const IndexIterator &rhs) {
+        return lhs.m_i > rhs.m_i;
+    }
+    friend bool operator<=(const IndexIterator &lhs, const IndexIterator &rhs) {
+        return lhs.m_i <= rhs.m_i;
+    }
+    friend bool operator>=(const IndexIterator &lhs, const IndexIterator &rhs) {
+        return lhs.m_i >= rhs.m_i;
+    }
+
+private:
+    const Func *m_func{nullptr};
+    difference_type m_i{0};
+};
+
+/// @brief Random-access view of size \p size that yields \p func(i).
+template <typename Func> class IndexView {
+public:
+    using iterator = IndexIterator<Func>;
+    using const_iterator = iterator;
+    using difference_type = typename iterator::difference_type;
+    using size_type = std::size_t;
+    using value_type = typename iterator::value_type;
+    using reference = typename iterator::reference;
+
+    IndexView(difference_type size, Func func)
+        : m_size{std::max<difference_type>(size, 0)}, m_func{std::move(func)} {
+    }
+
+    iterator begin() const { return {&m_func, 0}; }
+    iterator end() const { return {&m_func, m_size}; }
+    size_type size() const { return static_cast<size_type>(m_size); }
+    bool empty() const { return m_size == 0; }
+    reference operator[](difference_type i) const { return m_func(i); }
+
+private:
+    difference_type m_size;
+    Func m_func;
+};
+
+template <typename Func> auto make_view(std::ptrdiff_t size, Func &&func) {
+    return IndexView<std::decay_t<Func>>(size, FWD(func));
+}
+
+/// @brief Returns view of the integer sequence [first, last).
+template <typename Index,
+          typename = std::enable_if_t<std::is_integral_v<Index>>>
+auto iota(Index first, Index last) {
+    return make_view(static_cast<std::ptrdiff_t>(last - first),
+                     [first](std::ptrdiff_t i) {
+                         return static_cast<Index>(first + i);
+                     });
+}
+
+/// @brief Returns view of the integer sequence [0, size).
+template <typename Index,
+          typename = std::enable_if_t<std::is_integral_v<Index>>>
+auto iota(Index size) {
+    return iota(Index{0}, size);
+}
+
+/// @brief Returns view of pairs [index, element reference] of random-access
+/// container \p v.
+template <typename T> auto enumerate(T &v) {
+    return make_view(
+        static_cast<std::ptrdiff_t>(std::size(v)),
+        [it = std::begin(v)](std::ptrdiff_t i) {
+            return std::pair<std::size_t, decltype(*(it + i))>(
+                static_cast<std::size_t>(i), *(it + i));
+        });
+}
+template <typename T> auto enumerate(T &&v) = delete;
+
+/// @brief Returns view of tuples of element references of random-access
+/// containers \p vs. The size of the view is the min size of \p vs.
+template <typename... Ts> auto zip(Ts &... vs) {
+    static_assert(sizeof...(Ts) > 0, "NEED AT LEAST ONE CONTAINER TO ZIP");
+    auto size = std::min({static_cast<std::ptrdiff_t>(std::size(vs))...});
+    return make_view(size, [its = std::make_tuple(std::begin(vs)...)](
+                               std::ptrdiff_t i) {
+        return std::apply(
+            [i](const auto &... its) {
+                return std::tuple<decltype(*(its + i))...>(*(its + i)...);
+            },
+            its);
+    });
+}
+
+} // namespace views
+
 /// @brief Create index sequence for container.
 template<typename Index, typename=std::enable_if_t<std::is_integral_v<Index>>>
 auto index(Index size) {
@@ -1,4 +1,5 @@
 #pragma once
+#include "meta.h"
 #include <Eigen/Core>
 #include <iterator>
 
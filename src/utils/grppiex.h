@@ -4,7 +4,13 @@
 #include "logging.h"
 #include <grppi/dyn/dynamic_execution.h>
 #include "formatter/enum.h"
+#include "grppiex/budget.h"
+#include "grppiex/placement.h"
+#include "grppiex/taskpool.h"
 #include <grppi/grppi.h>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
 
 namespace grppiex {
@@ -19,7 +25,8 @@ namespace grppiex {
  * @var omp
  *  Parallel execution with OpenMP.
  * @var tbb
- *  Parallel execution with Intel TBB
+ *  Parallel execution with Intel TBB. The TBB task scheduler uses
+ *  work-stealing, which suits tasks of uneven cost.
  * @var ff
  *  Parallel execution with FastFlow.
  */
@@ -43,6 +50,185 @@ BITMASK_(Mode, int, 0xFFFF,
 // clang-format on
 #endif
 
+namespace internal {
+
+/// @brief Create GRPPI execution object of type \p E.
+/// @param concurrency The concurrency degree. The default of the
+/// execution type is used if not positive.
+template <typename E>
+grppi::dynamic_execution make_execution(int concurrency) {
+    if constexpr (grppi::is_supported<E>() &&
+                  !std::is_same_v<E, grppi::sequential_execution>) {
+        E ex{};
+        if (concurrency > 0) {
+            ex.set_concurrency_degree(concurrency);
+        }
+        return ex;
+    } else {
+        return E{};
+    }
+}
+
+/// @brief Create GRPPI execution object of single mode \p m.
+inline grppi::dynamic_execution make_dyn_ex(Mode m, int concurrency) {
+    using namespace grppi;
+    SPDLOG_TRACE("create dynamic execution {} concurrency={}", m,
+                 concurrency);
+    switch (m) {
+    case Mode::seq: {
+        return make_execution<sequential_execution>(concurrency);
+    }
+    case Mode::thr: {
+        return make_execution<parallel_execution_native>(concurrency);
+    }
+    case Mode::omp: {
+        return make_execution<parallel_execution_omp>(concurrency);
+    }
+    case Mode::tbb: {
+        return make_execution<parallel_execution_tbb>(concurrency);
+    }
+    case Mode::ff: {
+        return make_execution<parallel_execution_ff>(concurrency);
+    }
+    default:
+        throw std::runtime_error("unknown grppi execution mode");
+    }
+}
+
+// concurrency degree of ex if it is of type E, and zero otherwise
+template <typename E> int concurrency_of(const grppi::dynamic_execution &ex) {
+    if constexpr (grppi::is_supported<E>()) {
+        // execution_ptr does not modify ex
+        if (auto p = const_cast<grppi::dynamic_execution &>(ex)
+                         .template execution_ptr<E>()) {
+            return p->concurrency_degree();
+        }
+    }
+    return 0;
+}
+
+/// @brief Returns the mode and concurrency degree limited to the
+/// \ref Budget of the calling thread.
+/// In nested parallel region, the concurrency is limited to the thread
+/// share, and the mode degrades to sequential if the share is one thread.
+inline std::pair<Mode, int> budgeted(Mode m, int concurrency) {
+    const auto &budget = Budget::instance();
+    if (m == Mode::seq || !budget.is_nested()) {
+        return {m, concurrency};
+    }
+    auto share = budget.limit(concurrency);
+    if (share <= 1) {
+        SPDLOG_TRACE("degrade dynamic execution {} to seq in nested region",
+                     m);
+        return {Mode::seq, 0};
+    }
+    return {m, share};
+}
+
+} // namespace internal
+
+/// @brief Returns the concurrency degree of \p ex, which is one for the
+/// sequential execution.
+inline int concurrency(const grppi::dynamic_execution &ex) {
+    using namespace grppi;
+    for (auto c : {internal::concurrency_of<parallel_execution_native>(ex),
+                   internal::concurrency_of<parallel_execution_omp>(ex),
+                   internal::concurrency_of<parallel_execution_tbb>(ex),
+                   internal::concurrency_of<parallel_execution_ff>(ex)}) {
+        if (c > 0) {
+            return c;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Process-wide registry of long-lived GRPPI execution objects.
+ * The execution objects are keyed by (mode, concurrency degree), and are
+ * created once on first request, such that callers share them instead of
+ * creating one per call. The references handed out stay valid for the
+ * lifetime of the process. The registry also owns the pools of worker
+ * threads that run the asynchronous tasks of \ref Future.
+ * @note The registry caches the execution objects, not threads. The native
+ * execution (\ref Mode::thr) starts its threads on every pattern call
+ * regardless, and the OpenMP and TBB executions run on the thread pools of
+ * their own runtimes.
+ */
+class Registry {
+public:
+    using key_t = std::pair<Mode, int>;
+
+    /// @brief Returns the registry instance.
+    static Registry &instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    /// @brief Returns the execution object of single mode \p m.
+    /// @param concurrency The concurrency degree. Zero for default.
+    const grppi::dynamic_execution &get(Mode m, int concurrency = 0) {
+        if (m == Mode::seq || concurrency < 0) {
+            concurrency = 0;
+        }
+        std::scoped_lock lock(m_mutex);
+        auto it = m_executions.find({m, concurrency});
+        if (it == m_executions.end()) {
+            SPDLOG_DEBUG("register dynamic execution {} concurrency={}", m,
+                         concurrency);
+            it = m_executions
+                     .emplace(key_t{m, concurrency},
+                              internal::make_dyn_ex(m, concurrency))
+                     .first;
+        }
+        return it->second;
+    }
+
+    /// @brief Returns the number of registered execution objects.
+    std::size_t size() const {
+        std::scoped_lock lock(m_mutex);
+        return m_executions.size();
+    }
+
+    /// @brief Returns the pool of \p n_threads worker threads, which is
+    /// created on first request.
+    internal::TaskPool &pool(int n_threads) {
+        n_threads = std::max(n_threads, 1);
+        std::scoped_lock lock(m_mutex);
+        auto &pool = m_pools[n_threads];
+        if (!pool) {
+            SPDLOG_DEBUG("create task pool of {} threads", n_threads);
+            pool = std::make_unique<internal::TaskPool>(n_threads);
+        }
+        return *pool;
+    }
+
+    /// @brief Release the resources held by the registry.
+    /// The task pools run their queued tasks and join their threads. They
+    /// are created again on request. The execution objects are kept, so
+    /// the references obtained from \ref get stay valid, e.g., those bound
+    /// to default arguments.
+    /// @note This shall not be called from a task of the pools.
+    void shutdown() {
+        decltype(m_pools) pools;
+        {
+            std::scoped_lock lock(m_mutex);
+            SPDLOG_DEBUG("shutdown registry of {} dynamic executions and {} "
+                         "task pools",
+                         m_executions.size(), m_pools.size());
+            pools.swap(m_pools);
+        }
+        // join outside the lock, as the tasks may request executions
+        pools.clear();
+    }
+
+private:
+    Registry() = default;
+    mutable std::mutex m_mutex;
+    std::map<key_t, grppi::dynamic_execution> m_executions;
+    // by number of threads
+    std::map<int, std::unique_ptr<internal::TaskPool>> m_pools;
+};
+
 /*
  * @brief Manage the available GRPPI execution modes.
  * @tparam modes The modes to use, sorted from high priority to low.
@@ -140,6 +326,9 @@ public:
 
     /// @brief Returns the GRPPI execution object of \p mode.
     /// Mode with higher prority is used if multiple modes are set.
+    /// Without \p args, the execution object is limited to the thread
+    /// budget of the calling thread.
+    /// @see \ref Budget
     template <typename... Args>
     static grppi::dynamic_execution dyn_ex(bitmask::bitmask<Mode> ms,
                                            Args &&... args) {
@@ -147,6 +336,12 @@ public:
         if (!(enabled() & ms))
             throw std::runtime_error(
                 fmt::format("grppi execution mode {:s} is not supported", ms));
+        if constexpr (sizeof...(Args) == 0) {
+            if (Budget::instance().is_nested()) {
+                auto [m, concurrency] = internal::budgeted(default_(ms), 0);
+                return internal::make_dyn_ex(m, concurrency);
+            }
+        }
         return [&](Mode m) -> grppi::dynamic_execution {
             SPDLOG_TRACE("create dynamic execution {}", m);
             switch (m) {
@@ -181,6 +376,31 @@ public:
         return dyn_ex(default_());
     }
 
+    /// @brief Returns the long-lived GRPPI execution object of \p mode
+    /// from the \ref Registry.
+    /// Mode with higher prority is used if multiple modes are set.
+    /// The execution object is limited to the thread budget of the
+    /// calling thread.
+    /// @param concurrency The concurrency degree. Zero for default.
+    /// @see \ref Budget
+    static const grppi::dynamic_execution &
+    shared_ex(bitmask::bitmask<Mode> ms, int concurrency = 0) {
+        if (!(enabled() & ms))
+            throw std::runtime_error(
+                fmt::format("grppi execution mode {:s} is not supported", ms));
+        auto [m, concurrency_] = internal::budgeted(default_(ms), concurrency);
+        return Registry::instance().get(m, concurrency_);
+    }
+    /// @brief Returns the long-lived GRPPI execution object of mode \p name.
+    template <typename... Args>
+    static const grppi::dynamic_execution &shared_ex(std::string_view name,
+                                                     Args &&... args) {
+        return shared_ex(from_name(name), FWD(args)...);
+    }
+    /// @brief Returns the long-lived GRPPI execution object of default mode.
+    static const grppi::dynamic_execution &shared_ex() {
+        return shared_ex(default_());
+    }
 };
 
 /// @brief The default Modes class with all supported modes enabled.
@@ -209,4 +429,16 @@ template <typename... Args> auto dyn_ex(Args... args) {
     return modes::dyn_ex(FWD(args)...);
 }
 
+/// @brief Returns the long-lived GRPPI execution object of \p mode.
+/// @see \ref Modes::shared_ex
+template <typename... Args>
+const grppi::dynamic_execution &shared_ex(Args... args) {
+    return modes::shared_ex(FWD(args)...);
+}
+
+/// @brief Release the resources held for the long-lived GRPPI execution
+/// objects.
+/// @see \ref Registry::shutdown
+inline void shutdown() { Registry::instance().shutdown(); }
+
 } // namespace grppiex
\ No newline at end of file
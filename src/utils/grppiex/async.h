@@ -0,0 +1,283 @@
+#pragma once
+#include "../grppiex.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace grppiex {
+
+namespace internal {
+
+// wrap func as copyable task, such that move-only callables can be queued
+template <typename F> TaskPool::task_t make_task(F &&func) {
+    auto p = std::make_shared<std::decay_t<F>>(FWD(func));
+    return [p]() { (*p)(); };
+}
+
+// true if ex is the sequential execution
+inline bool is_sequential(const grppi::dynamic_execution &ex) {
+    // execution_ptr does not modify ex
+    return const_cast<grppi::dynamic_execution &>(ex)
+               .execution_ptr<grppi::sequential_execution>() !=
+           nullptr;
+}
+
+// number of threads of the pool to run the tasks of ex, one per hardware
+// thread if ex is null
+inline int pool_size(const grppi::dynamic_execution *ex) {
+    if (ex == nullptr) {
+        return static_cast<int>(
+            std::max(std::thread::hardware_concurrency(), 2u));
+    }
+    return concurrency(*ex);
+}
+
+// run task on the calling thread if ex is sequential, and otherwise on the
+// pool of as many threads as the concurrency of ex
+inline void schedule(const grppi::dynamic_execution *ex,
+                     TaskPool::task_t task) {
+    if (ex != nullptr && is_sequential(*ex)) {
+        task();
+        return;
+    }
+    Registry::instance().pool(pool_size(ex)).submit(std::move(task));
+}
+
+// tasks to run once a result is set
+class Continuations {
+public:
+    using task_t = TaskPool::task_t;
+
+    // run task now if the result is set, or when it is set
+    void add(task_t task) {
+        {
+            std::scoped_lock lock(m_mutex);
+            if (!m_done) {
+                m_tasks.push_back(std::move(task));
+                return;
+            }
+        }
+        task();
+    }
+    // mark the result as set and run the pending tasks
+    void fire() {
+        std::vector<task_t> tasks;
+        {
+            std::scoped_lock lock(m_mutex);
+            m_done = true;
+            tasks.swap(m_tasks);
+        }
+        for (auto &task : tasks) {
+            task();
+        }
+    }
+
+private:
+    std::mutex m_mutex;
+    bool m_done{false};
+    std::vector<task_t> m_tasks;
+};
+
+} // namespace internal
+
+/**
+ * @brief Copyable handle of asynchronous computation.
+ * The handle wraps std::shared_future, and computations depending on the
+ * result can be chained with \ref then. Exceptions thrown by the
+ * computation are rethrown by \ref get.
+ * The computations are scheduled according to the execution object they are
+ * launched with: with the sequential execution they run on the thread that
+ * completes the computation they depend on, or the calling thread if there
+ * is none. Otherwise they run on the \ref internal::TaskPool of the
+ * \ref Registry with as many threads as the concurrency degree of the
+ * execution object, such that at most that many of the computations run at
+ * once. The GRPPI patterns called within the computations run with the
+ * backend of the execution object passed to them.
+ */
+template <typename T> class Future {
+public:
+    using value_type = T;
+
+    Future() = default;
+    /// @note A plain future gives no notification of its result, so the
+    /// continuations of the handle are deferred: they run on the thread
+    /// that waits for their result, and not at all if none does.
+    Future(std::shared_future<T> future) : m_future{std::move(future)} {}
+    Future(std::future<T> &&future) : m_future{future.share()} {}
+
+    /// @brief Returns true if the handle refers to a computation.
+    bool valid() const { return m_future.valid(); }
+    /// @brief Returns true if the result is available.
+    bool is_ready() const {
+        return m_future.wait_for(std::chrono::seconds(0)) ==
+               std::future_status::ready;
+    }
+    /// @brief Block until the result is available.
+    void wait() const { m_future.wait(); }
+    /// @brief Block until the result is available and returns it.
+    decltype(auto) get() const { return m_future.get(); }
+    /// @brief Returns the underlying std::shared_future.
+    const std::shared_future<T> &shared_future() const { return m_future; }
+
+    /**
+     * @brief Run \p func with the result once it is available.
+     * The continuation is scheduled with the execution object this
+     * computation is launched with.
+     * @param func Callable with signature U(const T&), or U() if T is void.
+     * @return The handle to the result of \p func.
+     */
+    template <typename F> auto then(F &&func) const {
+        return then_impl(m_ex, FWD(func));
+    }
+
+    /// @brief Run \p func with the result once it is available, scheduled
+    /// with \p ex.
+    /// @see then
+    template <typename F>
+    auto then(const grppi::dynamic_execution &ex, F &&func) const {
+        return then_impl(&ex, FWD(func));
+    }
+
+    /// @brief Run \p func asynchronously on the pool of one thread per
+    /// hardware thread.
+    /// @return The handle to the result of \p func.
+    template <typename F> static auto async(F &&func) {
+        return launch(nullptr, FWD(func));
+    }
+
+    /// @brief Run \p func scheduled with \p ex.
+    /// With the sequential execution, \p func runs before returning.
+    /// @return The handle to the result of \p func.
+    template <typename F>
+    static auto async(const grppi::dynamic_execution &ex, F &&func) {
+        return launch(&ex, FWD(func));
+    }
+
+private:
+    template <typename U> friend class Future;
+
+    std::shared_future<T> m_future{};
+    // null if created from a plain future
+    std::shared_ptr<internal::Continuations> m_continuations{};
+    // null for the pool of one thread per hardware thread
+    const grppi::dynamic_execution *m_ex{nullptr};
+
+    // schedule func with ex, once after is fired if set
+    template <typename F>
+    static auto launch(const grppi::dynamic_execution *ex, F &&func,
+                       std::shared_ptr<internal::Continuations> after = {}) {
+        using U = std::invoke_result_t<std::decay_t<F>>;
+        auto promise = std::make_shared<std::promise<U>>();
+        Future<U> result{promise->get_future()};
+        result.m_continuations = std::make_shared<internal::Continuations>();
+        result.m_ex = ex;
+        auto task = internal::make_task(
+            [promise, continuations = result.m_continuations,
+             func = std::decay_t<F>(FWD(func))]() mutable {
+                try {
+                    if constexpr (std::is_void_v<U>) {
+                        func();
+                        promise->set_value();
+                    } else {
+                        promise->set_value(func());
+                    }
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+                continuations->fire();
+            });
+        if (after) {
+            after->add([ex, task = std::move(task)]() {
+                internal::schedule(ex, task);
+            });
+        } else {
+            internal::schedule(ex, std::move(task));
+        }
+        return result;
+    }
+
+    template <typename F>
+    auto then_impl(const grppi::dynamic_execution *ex, F &&func) const {
+        auto task = [future = m_future, func = std::decay_t<F>(FWD(func))]() {
+            if constexpr (std::is_void_v<T>) {
+                future.get();
+                return func();
+            } else {
+                return func(future.get());
+            }
+        };
+        if (m_continuations) {
+            return launch(ex, std::move(task), m_continuations);
+        }
+        // no notification from a plain future, so run when waited for
+        using U = std::invoke_result_t<decltype(task)>;
+        Future<U> result{std::async(std::launch::deferred, std::move(task))};
+        result.m_ex = ex;
+        return result;
+    }
+};
+
+/// @brief Run \p func asynchronously on the pool of one thread per hardware
+/// thread.
+/// @see \ref Future::async
+template <typename F> auto async(F &&func) {
+    return Future<void>::async(FWD(func));
+}
+
+/// @brief Run \p func scheduled with \p ex.
+/// @see \ref Future::async
+template <typename F> auto async(const grppi::dynamic_execution &ex, F &&func) {
+    return Future<void>::async(ex, FWD(func));
+}
+
+namespace internal {
+
+// lvalues are kept as references, rvalues are moved in
+template <typename Func, typename... Args>
+auto async_apply(const grppi::dynamic_execution &ex, Func &&func,
+                 Args &&... args) {
+    return async(ex, [func = std::decay_t<Func>(FWD(func)),
+                      args = std::tuple<Args...>(FWD(args)...)]() mutable {
+        return std::apply(
+            [&func](auto &&... args) { return func(FWD(args)...); },
+            std::move(args));
+    });
+}
+
+} // namespace internal
+
+/**
+ * @brief Run grppi::map asynchronously with \p ex.
+ * The execution object and the lvalue arguments are referenced, and have
+ * to outlive the computation. The shared execution objects returned by
+ * \ref shared_ex satisfy this. With the sequential execution, the map
+ * runs before returning.
+ * @return The handle of type Future<void>.
+ */
+template <typename... Args>
+auto async_map(const grppi::dynamic_execution &ex, Args &&... args) {
+    return internal::async_apply(
+        ex, [&ex](auto &&... args) { grppi::map(ex, FWD(args)...); },
+        FWD(args)...);
+}
+
+/**
+ * @brief Run grppi::map_reduce asynchronously with \p ex.
+ * @see \ref async_map for the lifetime requirements.
+ * @return The handle to the reduced value.
+ */
+template <typename... Args>
+auto async_map_reduce(const grppi::dynamic_execution &ex, Args &&... args) {
+    return internal::async_apply(
+        ex,
+        [&ex](auto &&... args) {
+            return grppi::map_reduce(ex, FWD(args)...);
+        },
+        FWD(args)...);
+}
+
+} // namespace grppiex
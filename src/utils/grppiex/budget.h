@@ -0,0 +1,122 @@
+#pragma once
+#include "../meta.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+namespace grppiex {
+
+/**
+ * @brief Process-wide thread budget.
+ * The budget tracks the total number of threads, and the share of it
+ * available to the calling thread. Tasks wrapped with \ref budget_region
+ * run with the share of the enclosing region divided by the degree of
+ * the region. The threads of OpenMP parallel regions are handled
+ * automatically.
+ * Execution objects requested from nested regions via \ref shared_ex or
+ * \ref dyn_ex are limited to the share, and degrade to sequential if the
+ * share is one thread.
+ */
+class Budget {
+public:
+    /// @brief Returns the budget instance.
+    static Budget &instance() {
+        static Budget budget;
+        return budget;
+    }
+
+    /// @brief Returns the total number of threads.
+    int total() const { return m_total.load(); }
+    /// @brief Set the total number of threads.
+    /// The number of hardware threads is used if \p n is not positive.
+    void set_total(int n) { m_total = n > 0 ? n : hardware_concurrency(); }
+
+    /// @brief Returns true if the calling thread runs in parallel region.
+    bool is_nested() const {
+#if defined(_OPENMP)
+        if (omp_in_parallel()) {
+            return true;
+        }
+#endif
+        return local_share() > 0;
+    }
+
+    /// @brief Returns the number of threads available to the calling thread.
+    int share() const {
+        if (auto s = local_share(); s > 0) {
+            return s;
+        }
+#if defined(_OPENMP)
+        if (omp_in_parallel()) {
+            return std::max(total() / omp_get_num_threads(), 1);
+        }
+#endif
+        return total();
+    }
+
+    /// @brief Returns \p concurrency limited to \ref share.
+    /// The share is returned if \p concurrency is not positive.
+    int limit(int concurrency) const {
+        auto s = share();
+        return concurrency > 0 ? std::min(concurrency, s) : s;
+    }
+
+private:
+    friend class BudgetScope;
+    Budget() = default;
+    std::atomic<int> m_total{hardware_concurrency()};
+
+    static int hardware_concurrency() {
+        return std::max(static_cast<int>(std::thread::hardware_concurrency()),
+                        1);
+    }
+    static int &local_share() {
+        thread_local int share{0};
+        return share;
+    }
+};
+
+/**
+ * @brief RAII scope in which the calling thread has the thread share
+ * \p share.
+ */
+class BudgetScope {
+public:
+    explicit BudgetScope(int share) : m_share{Budget::local_share()} {
+        Budget::local_share() = std::max(share, 1);
+    }
+    ~BudgetScope() { Budget::local_share() = m_share; }
+    BudgetScope(const BudgetScope &) = delete;
+    BudgetScope &operator=(const BudgetScope &) = delete;
+
+private:
+    int m_share;
+};
+
+/**
+ * @brief Returns callable that runs \p func as task of parallel region of
+ * \p degree concurrent tasks.
+ * The share of the calling thread is divided among the tasks.
+ */
+template <typename F> auto budget_region(int degree, F &&func) {
+    auto share = std::max(Budget::instance().share() / std::max(degree, 1), 1);
+    return [share, func = std::decay_t<F>(FWD(func))](
+               auto &&... args) -> decltype(auto) {
+        BudgetScope scope{share};
+        return func(FWD(args)...);
+    };
+}
+
+/**
+ * @brief Returns callable that runs \p func as task of parallel region
+ * that uses all the share of the calling thread.
+ * Execution objects requested in the tasks are sequential.
+ */
+template <typename F> auto budget_region(F &&func) {
+    return budget_region(Budget::instance().share(), FWD(func));
+}
+
+} // namespace grppiex
@@ -0,0 +1,149 @@
+#pragma once
+#include "../container.h"
+#include "../grppiex.h"
+#include "../logging.h"
+#include <algorithm>
+#include <thread>
+
+namespace grppiex {
+
+/**
+ * @brief Grain size policy to coalesce per-index tasks into blocks.
+ * With the fixed policy, the indices are dispatched in blocks of given size.
+ * With the auto policy, the block size is tuned from the per-item cost
+ * measured over the first few calls, such that each block runs for about
+ * \ref target_time and the data it touches fits in \ref cache_size.
+ * @note The measurements are not synchronized, so one grain object should
+ * not be used by concurrent calls.
+ * @see for_each_block, for_each_index
+ */
+struct Grain {
+    using Index = std::ptrdiff_t;
+
+    /// @brief Returns grain of fixed block size \p size.
+    static Grain fixed(Index size) {
+        Grain grain{};
+        grain.m_size = std::max<Index>(size, 1);
+        grain.m_n_tune = 0;
+        return grain;
+    }
+
+    /// @brief Returns auto-tuned grain.
+    /// @param item_size The number of bytes touched per item.
+    static Grain auto_(Index item_size = sizeof(double)) {
+        Grain grain{};
+        grain.item_size = std::max<Index>(item_size, 1);
+        return grain;
+    }
+
+    /// Target run time of one block in ms.
+    double target_time{0.05};
+    /// Max number of bytes touched by one block.
+    Index cache_size{256 * 1024};
+    /// Number of bytes touched per item.
+    Index item_size{sizeof(double)};
+    /// Number of items run sequentially to measure the per-item cost.
+    Index probe_size{256};
+    /// Min block size.
+    Index min_size{16};
+
+    /// @brief Returns true if the block size is determined.
+    bool is_tuned() const { return m_n_tuned >= m_n_tune; }
+    /// @brief Returns the current block size. Zero if not yet measured.
+    Index size() const { return m_size; }
+    /// @brief Discard the measurements of auto-tuned grain.
+    void reset() {
+        if (m_n_tune > 0) {
+            m_n_tuned = 0;
+            m_item_time = 0;
+            m_size = 0;
+        }
+    }
+
+    /// @brief Run \p func on the items [0, n) in blocks.
+    /// @param func Callable with signature void(Index begin, Index end).
+    template <typename Func>
+    void for_each_block(const grppi::dynamic_execution &ex, Index n,
+                        Func &&func) {
+        Index start = 0;
+        if (!is_tuned()) {
+            // run the probe on the calling thread
+            start = std::min(probe_size, n);
+            if (start > 0) {
+                auto t0 = logging::now();
+                FWD(func)(Index{0}, start);
+                update(logging::elapsed_since(t0) / start);
+            }
+        }
+        auto n_left = n - start;
+        if (n_left <= 0) {
+            return;
+        }
+        auto size = block_size(n_left);
+        auto n_blocks = (n_left + size - 1) / size;
+        auto blocks = container_utils::views::iota(n_blocks);
+        // the number of items run is reduced only to have no output buffer
+        grppi::map_reduce(
+            ex, blocks.begin(), blocks.end(), Index{0},
+            [&](Index i) {
+                auto begin = start + i * size;
+                auto end = std::min(begin + size, n);
+                FWD(func)(begin, end);
+                return end - begin;
+            },
+            [](Index lhs, Index rhs) { return lhs + rhs; });
+    }
+
+private:
+    // number of calls to measure the per-item cost
+    Index m_n_tune{3};
+    Index m_size{0};
+    Index m_n_tuned{0};
+    double m_item_time{0};
+
+    void update(double item_time) {
+        // running average of the per-item cost over the tuning calls
+        m_item_time = (m_item_time * m_n_tuned + item_time) / (m_n_tuned + 1);
+        ++m_n_tuned;
+        auto size = m_item_time > 0
+                        ? static_cast<Index>(target_time / m_item_time)
+                        : cache_size / item_size;
+        m_size = std::clamp(size, min_size,
+                            std::max(cache_size / item_size, min_size));
+        SPDLOG_TRACE("grain item_time={}ms size={} n_tuned={}", m_item_time,
+                     m_size, m_n_tuned);
+    }
+
+    Index block_size(Index n) const {
+        auto size = m_size;
+        if (m_n_tune > 0) {
+            // keep enough blocks to balance the load
+            Index n_workers = std::thread::hardware_concurrency();
+            size = std::min(size, std::max(n / (4 * n_workers), min_size));
+        }
+        return std::max<Index>(size, 1);
+    }
+};
+
+/// @brief Run \p func on the items [0, n) in blocks of size from \p grain.
+/// @param func Callable with signature void(Index begin, Index end).
+template <typename Func>
+void for_each_block(const grppi::dynamic_execution &ex, Grain::Index n,
+                    Func &&func, Grain &grain) {
+    grain.for_each_block(ex, n, FWD(func));
+}
+
+/// @brief Run \p func on each of the indices [0, n), coalesced in blocks of
+/// size from \p grain.
+/// @param func Callable with signature void(Index i).
+template <typename Func>
+void for_each_index(const grppi::dynamic_execution &ex, Grain::Index n,
+                    Func &&func, Grain &grain) {
+    grain.for_each_block(ex, n, [&func](auto begin, auto end) {
+        for (auto i = begin; i < end; ++i) {
+            func(i);
+        }
+    });
+}
+
+} // namespace grppiex
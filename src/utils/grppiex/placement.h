@@ -0,0 +1,344 @@
+#pragma once
+#include "../container.h"
+#include "../enum.h"
+#include "../logging.h"
+#include <Eigen/Core>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <grppi/grppi.h>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace grppiex {
+
+namespace internal {
+
+/// @brief Parse cpu list string like "0-3,8,10-11".
+/// Whitespace is ignored.
+inline std::vector<int> parse_cpulist(std::string str) {
+    str.erase(std::remove_if(str.begin(), str.end(),
+                             [](unsigned char c) { return std::isspace(c); }),
+              str.end());
+    std::vector<int> cpus;
+    std::stringstream ss{str};
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        auto sep = item.find('-');
+        auto first = std::stoi(item.substr(0, sep));
+        auto last =
+            sep == std::string::npos ? first : std::stoi(item.substr(sep + 1));
+        for (auto i = first; i <= last; ++i) {
+            cpus.push_back(i);
+        }
+    }
+    return cpus;
+}
+
+/// @brief Throw if any of \p cpus is not a valid cpu number.
+inline void check_cpus(const std::vector<int> &cpus) {
+#if defined(__linux__)
+    constexpr int n_max = CPU_SETSIZE;
+#else
+    const int n_max = std::numeric_limits<int>::max();
+#endif
+    for (auto cpu : cpus) {
+        if (cpu < 0 || cpu >= n_max) {
+            throw std::runtime_error(fmt::format(
+                "invalid cpu {}, expect in [0, {})", cpu, n_max));
+        }
+    }
+}
+
+/// @brief Returns the cpus allowed for the calling thread.
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; ++i) {
+            if (CPU_ISSET(i, &set)) {
+                cpus.push_back(i);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        cpus.resize(std::max(std::thread::hardware_concurrency(), 1u));
+        std::iota(cpus.begin(), cpus.end(), 0);
+    }
+    return cpus;
+}
+
+/// @brief Returns the allowed cpus grouped by NUMA node.
+inline std::vector<std::vector<int>> numa_cpus() {
+    auto allowed = allowed_cpus();
+    std::vector<std::vector<int>> nodes;
+#if defined(__linux__)
+    for (int i = 0;; ++i) {
+        std::ifstream f{fmt::format("/sys/devices/system/node/node{}/cpulist",
+                                    i)};
+        if (!f) {
+            break;
+        }
+        std::string str;
+        std::getline(f, str);
+        std::vector<int> cpus;
+        for (auto cpu : parse_cpulist(str)) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) !=
+                allowed.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.emplace_back(std::move(cpus));
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        nodes.emplace_back(std::move(allowed));
+    }
+    return nodes;
+}
+
+/// @brief Returns the cpus of \p nodes, filling one node before the next.
+inline std::vector<int>
+compact_cpus(const std::vector<std::vector<int>> &nodes) {
+    std::vector<int> result;
+    for (const auto &node : nodes) {
+        result.insert(result.end(), node.begin(), node.end());
+    }
+    return result;
+}
+
+/// @brief Returns the cpus of \p nodes, taken round-robin across the nodes.
+inline std::vector<int>
+scatter_cpus(const std::vector<std::vector<int>> &nodes) {
+    std::vector<int> result;
+    for (std::size_t i = 0;; ++i) {
+        auto n = result.size();
+        for (const auto &node : nodes) {
+            if (i < node.size()) {
+                result.push_back(node[i]);
+            }
+        }
+        if (n == result.size()) {
+            break;
+        }
+    }
+    return result;
+}
+
+} // namespace internal
+
+/**
+ * @brief Restriction of the cpuset of the calling thread.
+ * Threads created by the calling thread while the restriction is in place
+ * inherit the cpuset. The threads are not pinned to individual cpus, the
+ * OS scheduler still moves them freely within the set. The cpuset of the
+ * calling thread is restored on destruction.
+ */
+class ScopedCpuset {
+public:
+    /// @param cpus The cpus of the set. Nothing is done if empty.
+    /// @throws std::runtime_error if any of the cpu numbers is invalid.
+    explicit ScopedCpuset(const std::vector<int> &cpus) {
+        if (cpus.empty()) {
+            return;
+        }
+        internal::check_cpus(cpus);
+#if defined(__linux__)
+        if (pthread_getaffinity_np(pthread_self(), sizeof(m_saved),
+                                   &m_saved) != 0) {
+            SPDLOG_WARN("unable to get cpu mask of thread");
+            return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus) {
+            CPU_SET(cpu, &set);
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            SPDLOG_WARN("unable to restrict thread to cpus {}", cpus);
+            return;
+        }
+        SPDLOG_DEBUG("restrict thread to cpus {}", cpus);
+        m_applied = true;
+#else
+        SPDLOG_WARN("cpuset restriction is not supported on this platform");
+#endif
+    }
+    ~ScopedCpuset() {
+#if defined(__linux__)
+        if (m_applied &&
+            pthread_setaffinity_np(pthread_self(), sizeof(m_saved),
+                                   &m_saved) != 0) {
+            SPDLOG_WARN("unable to restore cpu mask of thread");
+        }
+#endif
+    }
+    ScopedCpuset(const ScopedCpuset &) = delete;
+    ScopedCpuset &operator=(const ScopedCpuset &) = delete;
+
+    /// @brief Returns true if the restriction is applied.
+    bool is_applied() const { return m_applied; }
+
+private:
+    bool m_applied{false};
+#if defined(__linux__)
+    cpu_set_t m_saved;
+#endif
+};
+
+/**
+ * @brief Policy to choose the cpuset of execution objects.
+ * The placement restricts the cpuset of the calling thread for the
+ * lifetime of the \ref ScopedCpuset returned by \ref restrict_cpus.
+ * It does not pin threads to individual cpus: the policies only choose
+ * which cpus, and hence which NUMA nodes, make up the set. Only threads
+ * created while the restriction is in place inherit it, so which
+ * executions honour it depends on the backend:
+ *  - \ref Mode::thr starts its worker threads on every pattern call, so
+ *  patterns called within the scope run on the cpuset.
+ *  - \ref Mode::omp creates its thread pool on the first parallel region
+ *  of the process, so the cpuset only applies if that region runs
+ *  within the scope. OMP_PROC_BIND and OMP_PLACES are the reliable way to
+ *  pin OpenMP threads.
+ *  - \ref Mode::tbb and \ref Mode::ff manage their own threads, which are
+ *  not affected.
+ * @code
+ * Placement placement{Placement::Policy::compact};
+ * auto cpuset = placement.restrict_cpus(4);
+ * grppi::map(grppiex::shared_ex("thr", 4), ...);
+ * @endcode
+ */
+struct Placement {
+    /**
+     * @enum Policy
+     * @var none
+     *  The cpuset is not restricted.
+     * @var compact
+     *  Fill the cpus of one NUMA node before moving to the next.
+     * @var scatter
+     *  Take the cpus round-robin across NUMA nodes.
+     * @var list
+     *  Use the explicit cpu list.
+     */
+    META_ENUM(Policy, int, none = 0, compact = 1, scatter = 2, list = 3);
+
+    Policy policy{Policy::none};
+    /// The cpu list used with \ref Policy::list.
+    std::vector<int> cpus{};
+
+    /// @brief Returns the cpuset to run \p concurrency threads on, from the
+    /// allowed cpus grouped by NUMA node in \p nodes.
+    /// @throws std::runtime_error if the cpu list has invalid cpu numbers.
+    /// @param concurrency The number of threads. It is required to be
+    /// positive for \ref Policy::compact and \ref Policy::scatter, with
+    /// which all allowed cpus would be no placement at all.
+    std::vector<int> resolve(int concurrency,
+                             const std::vector<std::vector<int>> &nodes) const {
+        std::vector<int> result;
+        switch (policy) {
+        case Policy::none: {
+            return result;
+        }
+        case Policy::list: {
+            internal::check_cpus(cpus);
+            result = cpus;
+            break;
+        }
+        case Policy::compact:
+        case Policy::scatter: {
+            if (concurrency <= 0) {
+                throw std::runtime_error(fmt::format(
+                    "placement {} requires positive concurrency, got {}",
+                    Policy_meta::to_name(policy), concurrency));
+            }
+            result = policy == Policy::compact ? internal::compact_cpus(nodes)
+                                               : internal::scatter_cpus(nodes);
+            break;
+        }
+        }
+        if (concurrency > 0 &&
+            result.size() > static_cast<std::size_t>(concurrency)) {
+            result.resize(static_cast<std::size_t>(concurrency));
+        }
+        return result;
+    }
+
+    /// @brief Returns the cpuset to run \p concurrency threads on.
+    std::vector<int> resolve(int concurrency = 0) const {
+        if (policy == Policy::none || policy == Policy::list) {
+            return resolve(concurrency, {});
+        }
+        return resolve(concurrency, internal::numa_cpus());
+    }
+
+    /// @brief Restrict the cpuset of the calling thread to the cpus from
+    /// \ref resolve, until the returned object is destroyed.
+    ScopedCpuset restrict_cpus(int concurrency = 0) const {
+        return ScopedCpuset{resolve(concurrency)};
+    }
+};
+REGISTER_META_ENUM(Placement::Policy);
+
+/**
+ * @brief Zero-fill a plain Eigen object in parallel with \p ex.
+ * Memory pages are placed on the NUMA node of the thread that first
+ * writes to them, so the buffer is spread over the nodes of the threads
+ * of \p ex rather than all placed on the node of the calling thread.
+ * @note grppi does not guarantee which thread runs which block, so the
+ * pages are not necessarily local to the threads that process them later.
+ * @param n_blocks The number of contiguous blocks to fill. Default is
+ * the number of hardware threads.
+ */
+template <typename Derived>
+void first_touch(const grppi::dynamic_execution &ex,
+                 Eigen::PlainObjectBase<Derived> &m, Eigen::Index n_blocks = 0) {
+    using Eigen::Index;
+    if (n_blocks <= 0) {
+        n_blocks = std::max<Index>(std::thread::hardware_concurrency(), 1);
+    }
+    const auto size = m.size();
+    n_blocks = std::max<Index>(std::min(n_blocks, size), 1);
+    auto blocks = container_utils::views::iota(n_blocks);
+    auto *data = m.data();
+    // the number of items filled is reduced only to have no output buffer
+    grppi::map_reduce(
+        ex, blocks.begin(), blocks.end(), Index{0},
+        [&](Index i) {
+            auto begin = size * i / n_blocks;
+            auto end = size * (i + 1) / n_blocks;
+            std::fill(data + begin, data + end, typename Derived::Scalar{0});
+            return end - begin;
+        },
+        [](Index lhs, Index rhs) { return lhs + rhs; });
+}
+
+/**
+ * @brief Create plain Eigen object of given shape with \ref first_touch.
+ */
+template <typename PlainObject>
+PlainObject make_first_touch(const grppi::dynamic_execution &ex,
+                             Eigen::Index rows, Eigen::Index cols = 1,
+                             Eigen::Index n_blocks = 0) {
+    PlainObject m(rows, cols);
+    first_touch(ex, m, n_blocks);
+    return m;
+}
+
+} // namespace grppiex
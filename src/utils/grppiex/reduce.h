@@ -0,0 +1,97 @@
+#pragma once
+#include "../container.h"
+#include "../grppiex.h"
+#include <iterator>
+
+namespace grppiex {
+
+/**
+ * @brief Reproducible map-reduce.
+ * The input is split into blocks of fixed size \p block_size, each of which
+ * is reduced sequentially from left to right, and the per-block results are
+ * combined with a fixed pairwise tree. The order of combination therefore
+ * only depends on the input size and the block size, so the result is
+ * identical among all execution modes and concurrency degrees, including
+ * for non-associative operations like floating-point sums.
+ * @param identity The identity value of \p combine.
+ * @param transform Callable with signature T(const value_type&).
+ * @param combine Callable with signature T(const T&, const T&).
+ * @param block_size The number of items reduced sequentially.
+ */
+template <typename InputIt, typename Identity, typename Transformer,
+          typename Combiner>
+auto reproducible_map_reduce(const grppi::dynamic_execution &ex,
+                             InputIt first, InputIt last, Identity &&identity,
+                             Transformer &&transform, Combiner &&combine,
+                             std::ptrdiff_t block_size = 4096) {
+    static_assert(std::is_base_of_v<std::random_access_iterator_tag,
+                                    typename std::iterator_traits<
+                                        InputIt>::iterator_category>,
+                  "REPRODUCIBLE REDUCE REQUIRES RANDOM ACCESS ITERATOR");
+    using T = std::decay_t<Identity>;
+    const auto n = std::distance(first, last);
+    if (block_size <= 0) {
+        throw std::runtime_error(
+            fmt::format("invalid reduce block size {}", block_size));
+    }
+    const auto n_blocks = (n + block_size - 1) / block_size;
+    if (n_blocks == 0) {
+        return T(identity);
+    }
+    auto blocks = container_utils::views::iota(n_blocks);
+    std::vector<T> partials(blocks.size(), identity);
+    grppi::map(ex, blocks.begin(), blocks.end(), partials.begin(),
+               [&](auto i) {
+                   auto it = first + i * block_size;
+                   auto end = first + std::min(n, (i + 1) * block_size);
+                   T acc(identity);
+                   for (; it != end; ++it) {
+                       acc = combine(acc, transform(*it));
+                   }
+                   return acc;
+               });
+    // pairwise tree over the partials
+    for (std::size_t stride = 1; stride < partials.size(); stride *= 2) {
+        for (std::size_t i = 0; i + stride < partials.size(); i += 2 * stride) {
+            partials[i] = combine(partials[i], partials[i + stride]);
+        }
+    }
+    return std::move(partials.front());
+}
+
+/// @brief Reproducible map-reduce of range \p in.
+/// @see \ref reproducible_map_reduce
+template <typename Range, typename Identity, typename Transformer,
+          typename Combiner>
+auto reproducible_map_reduce(const grppi::dynamic_execution &ex, Range &&in,
+                             Identity &&identity, Transformer &&transform,
+                             Combiner &&combine,
+                             std::ptrdiff_t block_size = 4096) {
+    return reproducible_map_reduce(ex, std::begin(in), std::end(in),
+                                   FWD(identity), FWD(transform),
+                                   FWD(combine), block_size);
+}
+
+/// @brief Reproducible reduce.
+/// @see \ref reproducible_map_reduce
+template <typename InputIt, typename Identity, typename Combiner>
+auto reproducible_reduce(const grppi::dynamic_execution &ex, InputIt first,
+                         InputIt last, Identity &&identity, Combiner &&combine,
+                         std::ptrdiff_t block_size = 4096) {
+    return reproducible_map_reduce(
+        ex, first, last, FWD(identity),
+        [](const auto &x) -> decltype(auto) { return x; }, FWD(combine),
+        block_size);
+}
+
+/// @brief Reproducible reduce of range \p in.
+/// @see \ref reproducible_map_reduce
+template <typename Range, typename Identity, typename Combiner>
+auto reproducible_reduce(const grppi::dynamic_execution &ex, Range &&in,
+                         Identity &&identity, Combiner &&combine,
+                         std::ptrdiff_t block_size = 4096) {
+    return reproducible_reduce(ex, std::begin(in), std::end(in),
+                               FWD(identity), FWD(combine), block_size);
+}
+
+} // namespace grppiex
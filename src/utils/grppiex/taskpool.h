@@ -0,0 +1,79 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace grppiex::internal {
+
+/**
+ * @brief Fixed-size pool of worker threads to run asynchronous tasks.
+ * The threads are created once, so scheduling a task does not create an OS
+ * thread. The pools are owned by the \ref Registry.
+ * @note Tasks blocking on the results of other tasks of the pool may
+ * exhaust the pool. Use \ref Future::then to chain computations instead.
+ */
+class TaskPool {
+public:
+    using task_t = std::function<void()>;
+
+    explicit TaskPool(unsigned n_threads) {
+        m_threads.reserve(n_threads);
+        for (unsigned i = 0; i < n_threads; ++i) {
+            m_threads.emplace_back([this]() { run(); });
+        }
+    }
+    /// @brief Run the queued tasks and join the threads.
+    ~TaskPool() {
+        {
+            std::scoped_lock lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto &t : m_threads) {
+            t.join();
+        }
+    }
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    /// @brief Returns the number of threads.
+    std::size_t size() const { return m_threads.size(); }
+
+    /// @brief Queue \p task to run on one of the threads.
+    void submit(task_t task) {
+        {
+            std::scoped_lock lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_cv.notify_one();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<task_t> m_tasks;
+    std::vector<std::thread> m_threads;
+    bool m_stop{false};
+
+    void run() {
+        for (;;) {
+            task_t task;
+            {
+                std::unique_lock lock(m_mutex);
+                m_cv.wait(lock,
+                          [this]() { return m_stop || !m_tasks.empty(); });
+                if (m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+} // namespace grppiex::internal
@@ -0,0 +1,194 @@
+#pragma once
+#include "../formatter/matrix.h"
+#include "../formatter/utils.h"
+#include "../grppiex.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace grppiex {
+
+/**
+ * @brief Snapshot of the execution telemetry.
+ * The times are in ms. The wall time spans from the start of the first task
+ * to the end of the last task. The idle time is the wall time of all
+ * workers that are not spent in tasks.
+ */
+struct TelemetrySnapshot {
+    /// Number of tasks run.
+    std::size_t n_tasks{0};
+    /// Number of tasks per worker.
+    std::vector<std::size_t> worker_tasks{};
+    /// Busy time per worker.
+    std::vector<double> busy_time{};
+    /// The wall time.
+    double wall_time{0};
+    /// The sum of idle time of all workers.
+    double idle_time{0};
+    /// The ratio of max to mean of the per-worker busy time.
+    double imbalance{0};
+};
+
+/**
+ * @brief Instrumented wrapper of GRPPI execution object.
+ * The callables passed to GRPPI patterns are wrapped with \ref wrap, so that
+ * each invocation is recorded as a task of the worker thread running it.
+ * @tparam enabled If false, nothing is recorded and \ref wrap returns the
+ * callable as is.
+ */
+template <bool enabled = true> class Instrumented {
+public:
+    Instrumented(const grppi::dynamic_execution &ex) : m_ex{ex} {}
+    Instrumented(const Instrumented &) = delete;
+    Instrumented &operator=(const Instrumented &) = delete;
+
+    /// @brief Returns the execution object to be passed to GRPPI patterns.
+    const grppi::dynamic_execution &ex() const { return m_ex; }
+
+    /// @brief Returns callable that invokes \p func as recorded task.
+    template <typename F> auto wrap(F &&func) {
+        if constexpr (enabled) {
+            return [this, fargs = FWD_CAPTURE(func)](auto &&... args)
+                       -> decltype(auto) {
+                auto &&[func] = fargs;
+                auto t0 = clock::now();
+                struct finalize_t {
+                    Instrumented *self;
+                    clock::time_point t0;
+                    ~finalize_t() { self->record(t0, clock::now()); }
+                } finalize{this, t0};
+                return FWD(func)(FWD(args)...);
+            };
+        } else {
+            return std::decay_t<F>(FWD(func));
+        }
+    }
+
+    /// @brief Returns the snapshot of the recorded telemetry.
+    TelemetrySnapshot snapshot() const {
+        TelemetrySnapshot s{};
+        if constexpr (enabled) {
+            std::scoped_lock lock(m_mutex);
+            for (const auto &w : m_workers) {
+                auto n = w.n_tasks.load();
+                s.n_tasks += n;
+                s.worker_tasks.push_back(n);
+                s.busy_time.push_back(to_ms(w.busy_time.load()));
+            }
+            if (s.n_tasks == 0) {
+                return s;
+            }
+            s.wall_time = to_ms(m_t1.load() - m_t0.load());
+            auto n_workers = static_cast<double>(m_workers.size());
+            auto busy = std::accumulate(s.busy_time.begin(), s.busy_time.end(),
+                                        0.);
+            s.idle_time = std::max(s.wall_time * n_workers - busy, 0.);
+            auto busy_max =
+                *std::max_element(s.busy_time.begin(), s.busy_time.end());
+            s.imbalance = busy > 0 ? busy_max / (busy / n_workers) : 1.;
+        }
+        return s;
+    }
+
+    /// @brief Discard the recorded telemetry.
+    void reset() {
+        if constexpr (enabled) {
+            std::scoped_lock lock(m_mutex);
+            m_workers.clear();
+            m_t0 = std::numeric_limits<rep_t>::max();
+            m_t1 = std::numeric_limits<rep_t>::min();
+            m_token = next_token();
+        }
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+    using rep_t = clock::rep;
+    struct Worker {
+        Worker(std::thread::id id_) : id{id_} {}
+        std::thread::id id;
+        std::atomic<std::size_t> n_tasks{0};
+        std::atomic<rep_t> busy_time{0};
+    };
+
+    const grppi::dynamic_execution &m_ex;
+    mutable std::mutex m_mutex;
+    // deque keeps the worker references valid when growing
+    std::deque<Worker> m_workers;
+    std::atomic<rep_t> m_t0{std::numeric_limits<rep_t>::max()};
+    std::atomic<rep_t> m_t1{std::numeric_limits<rep_t>::min()};
+    // identifies the worker slots cached by the threads
+    std::atomic<std::size_t> m_token{next_token()};
+
+    static std::size_t next_token() {
+        static std::atomic<std::size_t> token{0};
+        return ++token;
+    }
+
+    static double to_ms(rep_t t) {
+        return std::chrono::duration<double, std::milli>(clock::duration{t})
+            .count();
+    }
+
+    Worker &worker() {
+        // cache the worker slot of the calling thread
+        thread_local struct {
+            std::size_t token{0};
+            Worker *worker{nullptr};
+        } cache;
+        if (cache.token != m_token) {
+            std::scoped_lock lock(m_mutex);
+            auto id = std::this_thread::get_id();
+            auto it = std::find_if(m_workers.begin(), m_workers.end(),
+                                   [&id](const auto &w) { return w.id == id; });
+            cache.worker = it != m_workers.end()
+                               ? &(*it)
+                               : &m_workers.emplace_back(id);
+            cache.token = m_token;
+        }
+        return *cache.worker;
+    }
+
+    void record(clock::time_point t0, clock::time_point t1) {
+        auto &w = worker();
+        ++w.n_tasks;
+        w.busy_time += (t1 - t0).count();
+        auto t = t0.time_since_epoch().count();
+        auto v = m_t0.load();
+        while (t < v && !m_t0.compare_exchange_weak(v, t)) {
+        }
+        t = t1.time_since_epoch().count();
+        v = m_t1.load();
+        while (t > v && !m_t1.compare_exchange_weak(v, t)) {
+        }
+    }
+};
+
+/// @brief Returns instrumented wrapper of \p ex.
+/// @see \ref Instrumented
+template <bool enabled = true>
+auto instrument(const grppi::dynamic_execution &ex) {
+    return Instrumented<enabled>{ex};
+}
+
+} // namespace grppiex
+
+namespace fmt {
+
+template <>
+struct formatter<grppiex::TelemetrySnapshot, char>
+    : fmt_utils::nullspec_formatter_base {
+    template <typename FormatContext>
+    auto format(const grppiex::TelemetrySnapshot &s, FormatContext &ctx)
+        -> decltype(ctx.out()) {
+        return format_to(ctx.out(),
+                         "n_tasks={} wall_time={:.3f}ms idle_time={:.3f}ms "
+                         "imbalance={:.3f} worker_tasks={} busy_time={}",
+                         s.n_tasks, s.wall_time, s.idle_time, s.imbalance,
+                         s.worker_tasks, s.busy_time);
+    }
+};
+
+} // namespace fmt
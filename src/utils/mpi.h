@@ -1,9 +1,15 @@
+#pragma once
 #include "enum.h"
 #include "formatter/ptr.h"
 #include "formatter/utils.h"
+#include "grppiex.h"
 #include "logging.h"
 #include <Eigen/Core>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <mxx/comm.hpp>
+#include <mxx/datatypes.hpp>
 #include <mxx/env.hpp>
 #include <mxx/utils.hpp>
 #include <sstream>
@@ -20,7 +26,8 @@ inline auto logging_init(const mxx::comm &comm) {
 }
 
 struct env : mxx::env {
-    META_ENUM(WinMemoryModel, int, Unified, Separate, Unknown, NotSupported);
+    META_ENUM(WinMemoryModel, int, Unified = 0, Separate = 1, Unknown = 2,
+              NotSupported = 3);
     template <typename... Args> env(Args... args) : mxx::env(args...) {
         // get memory model
         int *attr_val;
@@ -246,6 +253,211 @@ template <typename T, typename Index> struct Span {
     }
 };
 
+/// Combiner for the minimum, reduced with MPI_MIN by map_reduce.
+struct minimum {
+    template <typename T> constexpr T operator()(const T &l, const T &r) const {
+        return std::min(l, r);
+    }
+};
+
+/// Combiner for the maximum, reduced with MPI_MAX by map_reduce.
+struct maximum {
+    template <typename T> constexpr T operator()(const T &l, const T &r) const {
+        return std::max(l, r);
+    }
+};
+
+namespace internal {
+
+template <typename T, typename = void>
+struct is_serializable : std::false_type {};
+
+template <typename T>
+struct is_serializable<
+    T, std::void_t<decltype(std::declval<const T &>().serialize()),
+                   decltype(T::deserialize(std::declval<std::string_view>()))>>
+    : std::true_type {};
+
+template <typename T, template <typename> typename F, typename Combiner>
+inline constexpr bool is_functor_v =
+    std::is_same_v<Combiner, F<T>> || std::is_same_v<Combiner, F<void>>;
+
+/**
+ * @brief Whether \p Combiner on arithmetic type \p T maps to a built-in
+ * MPI op.
+ */
+template <typename T, typename Combiner>
+inline constexpr bool has_builtin_op_v =
+    std::is_arithmetic_v<T> &&
+    (is_functor_v<T, std::plus, Combiner> ||
+     is_functor_v<T, std::multiplies, Combiner> ||
+     std::is_same_v<Combiner, minimum> || std::is_same_v<Combiner, maximum>);
+
+/// The built-in MPI op of \p Combiner, see \ref has_builtin_op_v.
+template <typename T, typename Combiner> MPI_Op builtin_op() {
+    static_assert(has_builtin_op_v<T, Combiner>, "NO BUILTIN MPI OP");
+    if constexpr (is_functor_v<T, std::plus, Combiner>) {
+        return MPI_SUM;
+    } else if constexpr (is_functor_v<T, std::multiplies, Combiner>) {
+        return MPI_PROD;
+    } else if constexpr (std::is_same_v<Combiner, minimum>) {
+        return MPI_MIN;
+    } else {
+        return MPI_MAX;
+    }
+}
+
+/**
+ * @brief Reduce \p value across all ranks with MPI_Allreduce, using
+ * \p reduce as the user op.
+ * The values are sent as contiguous bytes, and the op is created as
+ * non-commutative, so the values are combined in rank order. \p reduce
+ * has to be associative. \p T has to be trivially copyable and default
+ * constructible, as the op copies the values through unaligned buffers.
+ */
+template <typename T, typename Combiner>
+T allreduce_op(const mxx::comm &comm, const T &value, Combiner &&reduce) {
+    static_assert(std::is_trivially_copyable_v<T> &&
+                      std::is_default_constructible_v<T>,
+                  "TYPE HAS TO BE TRIVIALLY COPYABLE AND DEFAULT CONSTRUCTIBLE");
+    using reduce_t = std::remove_reference_t<Combiner>;
+    // the op reaches reduce through an attribute of the datatype
+    static const int keyval = []() {
+        int k;
+        MPI_Type_create_keyval(MPI_TYPE_NULL_COPY_FN,
+                               MPI_TYPE_NULL_DELETE_FN, &k, nullptr);
+        return k;
+    }();
+    MPI_Datatype type;
+    MPI_Type_contiguous(meta::size_cast<int>(sizeof(T)), MPI_BYTE, &type);
+    MPI_Type_commit(&type);
+    MPI_Type_set_attr(type, keyval,
+                      const_cast<void *>(static_cast<const void *>(&reduce)));
+    MPI_User_function *func = [](void *in, void *inout, int *len,
+                                 MPI_Datatype *type_) {
+        reduce_t *reduce_{nullptr};
+        int flag{0};
+        MPI_Type_get_attr(*type_, keyval, &reduce_, &flag);
+        assert(flag);
+        auto *in_ = static_cast<const char *>(in);
+        auto *inout_ = static_cast<char *>(inout);
+        // the buffers are not guaranteed to be aligned for T
+        T lhs, rhs;
+        for (int i = 0; i < *len; ++i) {
+            std::memcpy(&lhs, in_ + SIZET(i) * sizeof(T), sizeof(T));
+            std::memcpy(&rhs, inout_ + SIZET(i) * sizeof(T), sizeof(T));
+            T result = (*reduce_)(lhs, rhs);
+            std::memcpy(inout_ + SIZET(i) * sizeof(T), &result, sizeof(T));
+        }
+    };
+    MPI_Op op;
+    MPI_Op_create(func, 0, &op);
+    T result{value};
+    MPI_Allreduce(&value, &result, 1, type, op, comm);
+    MPI_Op_free(&op);
+    MPI_Type_free(&type);
+    return result;
+}
+
+/**
+ * @brief Gather \p value from all ranks and fold them in rank order.
+ * This takes O(P) memory and time per rank for P ranks, and is the fallback
+ * for types that are not trivially copyable.
+ */
+template <typename T, typename Combiner>
+T allgather_fold(const mxx::comm &comm, const T &value, Combiner &&reduce) {
+    // encode to bytes
+    std::string buf;
+    if constexpr (is_serializable<T>::value) {
+        buf = value.serialize();
+    } else {
+        static_assert(std::is_trivially_copyable_v<T> &&
+                          std::is_default_constructible_v<T>,
+                      "TYPE HAS TO BE TRIVIALLY COPYABLE AND DEFAULT "
+                      "CONSTRUCTIBLE, OR SERIALIZABLE");
+        buf.resize(sizeof(T));
+        std::memcpy(buf.data(), &value, sizeof(T));
+    }
+    auto decode = [](std::string_view b) {
+        if constexpr (is_serializable<T>::value) {
+            return T::deserialize(b);
+        } else {
+            T v;
+            std::memcpy(&v, b.data(), sizeof(T));
+            return v;
+        }
+    };
+    // gather sizes and the data
+    auto n_procs = SIZET(comm.size());
+    int size = meta::size_cast<int>(buf.size());
+    std::vector<int> sizes(n_procs);
+    MPI_Allgather(&size, 1, MPI_INT, sizes.data(), 1, MPI_INT, comm);
+    std::vector<int> displs(n_procs, 0);
+    std::partial_sum(sizes.begin(), sizes.end() - 1, displs.begin() + 1);
+    std::string bufs(SIZET(displs.back() + sizes.back()), '\0');
+    MPI_Allgatherv(buf.data(), size, MPI_CHAR, bufs.data(), sizes.data(),
+                   displs.data(), MPI_CHAR, comm);
+    auto get = [&](std::size_t i) {
+        return decode(std::string_view(bufs).substr(SIZET(displs[i]),
+                                                    SIZET(sizes[i])));
+    };
+    T result = get(0);
+    for (std::size_t i = 1; i < n_procs; ++i) {
+        result = reduce(result, get(i));
+    }
+    return result;
+}
+
+} // namespace internal
+
+/**
+ * @brief Hybrid MPI and thread parallel map-reduce.
+ * The range is split into contiguous blocks across the ranks of \p comm,
+ * and each block is map-reduced with GRPPI execution mode \p exmode. The
+ * partial results are then combined in rank order across the ranks and
+ * returned on all ranks:
+ *  - Arithmetic types reduced with std::plus, std::multiplies, \ref minimum
+ *  or \ref maximum are combined with MPI_Allreduce and the built-in op.
+ *  The built-in ops are commutative, so floating point results may differ
+ *  in the last bits between rank counts.
+ *  - Other trivially copyable types are combined with MPI_Allreduce, with
+ *  \p reduce as a non-commutative user op. The type has to be default
+ *  constructible as well.
+ *  - Other types are gathered to all ranks and folded, which costs O(P)
+ *  memory and time per rank for P ranks. The type has to provide member
+ *  function `std::string serialize() const` and static member function
+ *  `T deserialize(std::string_view)`.
+ * @param identity The identity value of \p reduce.
+ * @param map Callable with signature T(const value_type&).
+ * @param reduce Callable with signature T(const T&, const T&).
+ */
+template <typename Range, typename Identity, typename Transformer,
+          typename Combiner>
+auto map_reduce(const mxx::comm &comm, grppiex::Mode exmode, Range &&range,
+                Identity &&identity, Transformer &&map, Combiner &&reduce) {
+    using T = std::decay_t<Identity>;
+    auto first = std::begin(range);
+    auto n = std::distance(first, std::end(range));
+    auto rank = comm.rank();
+    auto n_procs = comm.size();
+    auto begin = first + n * rank / n_procs;
+    auto end = first + n * (rank + 1) / n_procs;
+    SPDLOG_TRACE("rank {}: map_reduce on [{}, {}) of {}", rank,
+                 std::distance(first, begin), std::distance(first, end), n);
+    T local = grppi::map_reduce(grppiex::shared_ex(exmode), begin, end,
+                                identity, FWD(map), reduce);
+    if constexpr (internal::has_builtin_op_v<T, std::decay_t<Combiner>>) {
+        T result{};
+        MPI_Allreduce(&local, &result, 1, mxx::get_datatype<T>().type(),
+                      internal::builtin_op<T, std::decay_t<Combiner>>(), comm);
+        return result;
+    } else if constexpr (std::is_trivially_copyable_v<T>) {
+        return internal::allreduce_op(comm, local, reduce);
+    } else {
+        return internal::allgather_fold(comm, local, reduce);
+    }
+}
+
 #define MPI_UTILS_DECLTYPE(v)                                                  \
     mxx::get_datatype<std::decay_t<decltype(v)>>().type()
 #define MPI_UTILS_GETTYPE(T) mxx::get_datatype<T>().type()
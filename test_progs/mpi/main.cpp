@@ -1,10 +1,14 @@
 #include <utils/logging.h>
+#include <array>
 #include <cstdlib>
+#include <limits>
 #include <mpi.h>
 #include <utils/grppiex.h>
 #include <utils/eigen.h>
 #include <utils/container.h>
 #include <utils/formatter/matrix.h>
+#include <utils/mpi.h>
+#include <utils/algorithm/tdigest.h>
 
 auto whoami() {
     int size, rank, namelen, verlen;
@@ -32,10 +36,39 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[]) {
     eigen_utils::asvec(data).array() += mpirank;
     SPDLOG_TRACE("rank {}: reduce data{}", mpirank, data);
     auto sum = grppi::reduce(
-        grppiex::dyn_ex(), data, 0.,
+        grppiex::shared_ex(), data, 0.,
         [](auto x, auto y) { return x+y;}
         );
     SPDLOG_TRACE("rank {}: result {}", mpirank, sum);
+    {
+        // run a map_reduce across all ranks
+        mpi_utils::comm comm;
+        auto all = container_utils::index(100);
+        auto total = mpi_utils::map_reduce(
+            comm, grppiex::default_mode(), all, 0.,
+            [](auto x) { return x * 1.; }, std::plus<>{});
+        // trivially copyable type reduced with the user op
+        using minmax_t = std::array<int, 2>;
+        auto minmax = mpi_utils::map_reduce(
+            comm, grppiex::default_mode(), all,
+            minmax_t{std::numeric_limits<int>::max(),
+                     std::numeric_limits<int>::min()},
+            [](auto x) { return minmax_t{x, x}; },
+            [](const auto &lhs, const auto &rhs) {
+                return minmax_t{std::min(lhs[0], rhs[0]),
+                                std::max(lhs[1], rhs[1])};
+            });
+        // serializable type combined from the serialized bytes
+        auto digest = mpi_utils::map_reduce(
+            comm, grppiex::default_mode(), all, alg::TDigest{},
+            [](auto x) {
+                alg::TDigest d;
+                return d.insert(x);
+            },
+            std::plus<>{});
+        SPDLOG_TRACE("rank {}: map_reduce result {} min={} max={} median={}",
+                     mpirank, total, minmax[0], minmax[1], digest.median());
+    }
     MPI_Finalize();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,155 @@
+// Heap allocations of the stats kernels. This is built as its own binary,
+// because the replaced operator new and the checked Eigen allocations
+// affect the timing of all benchmarks linked with them.
+
+// Eigen allocates with std::malloc, bypassing operator new. With
+// EIGEN_RUNTIME_NO_MALLOC, each allocation is checked with eigen_assert,
+// which is overridden to count the allocations while they are disallowed.
+#define EIGEN_RUNTIME_NO_MALLOC
+#define eigen_assert(x)                                                        \
+    ((x) ? static_cast<void>(0) : bench_allocs::on_eigen_assert(#x))
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace bench_allocs {
+
+std::atomic<std::int64_t> n_allocs{0};
+
+inline void on_eigen_assert(const char *expr) {
+    if (std::strstr(expr, "heap allocation is forbidden") != nullptr) {
+        ++n_allocs;
+        return;
+    }
+    std::fprintf(stderr, "eigen assertion failed: %s\n", expr);
+    std::abort();
+}
+
+} // namespace bench_allocs
+
+#include <benchmark/benchmark.h>
+
+#include "utils/algorithm/ei_medfilt.h"
+#include "utils/algorithm/ei_stats.h"
+#include "utils/algorithm/lacosmic1d.h"
+
+void *operator new(std::size_t size) {
+    ++bench_allocs::n_allocs;
+    if (auto p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Eigen::Index;
+using bench_allocs::n_allocs;
+
+// size of the median window
+constexpr Index window = 7;
+
+// count the allocations per iteration while in scope, Eigen allocations
+// are disallowed, and hence counted, only in this scope
+class AllocCounter {
+public:
+    explicit AllocCounter(benchmark::State &state)
+        : m_state{state}, m_n0{n_allocs.load()} {
+        Eigen::internal::set_is_malloc_allowed(false);
+    }
+    ~AllocCounter() {
+        Eigen::internal::set_is_malloc_allowed(true);
+        m_state.counters["allocs"] =
+            benchmark::Counter(static_cast<double>(n_allocs - m_n0),
+                               benchmark::Counter::kAvgIterations);
+    }
+    AllocCounter(const AllocCounter &) = delete;
+    AllocCounter &operator=(const AllocCounter &) = delete;
+
+private:
+    benchmark::State &m_state;
+    std::int64_t m_n0;
+};
+
+// sliding median that allocates per window position
+void bm_medfilt_alloc(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    Eigen::VectorXd out(n - window + 1);
+    AllocCounter counter{state};
+    for (auto _ : state) {
+        for (Index i = 0; i < out.size(); ++i) {
+            out.coeffRef(i) = alg::median(in.segment(i, window));
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+// sliding median with reused workspace
+void bm_medfilt_workspace(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    Eigen::VectorXd out(n - window + 1);
+    std::vector<double> workspace;
+    workspace.reserve(window);
+    AllocCounter counter{state};
+    for (auto _ : state) {
+        for (Index i = 0; i < out.size(); ++i) {
+            out.coeffRef(i) = alg::median(in.segment(i, window), workspace);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+// running median filter of window size given by the second argument
+void bm_medfilt1d(benchmark::State &state) {
+    const Index n = state.range(0);
+    const Index size = state.range(1);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    AllocCounter counter{state};
+    for (auto _ : state) {
+        auto out = alg::medfilt1d(in, size);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+// median filter of compile-time window size using the median network
+void bm_medfilt1d_network(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    AllocCounter counter{state};
+    for (auto _ : state) {
+        auto out = alg::medfilt1d<window>(in);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+void bm_lacosmic1d(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd data = Eigen::VectorXd::Random(n);
+    Eigen::VectorXd uncertainty = Eigen::VectorXd::Ones(n);
+    Eigen::VectorXb mask = Eigen::VectorXb::Zero(n);
+    const auto &ex = grppiex::shared_ex("seq");
+    AllocCounter counter{state};
+    for (auto _ : state) {
+        auto result = alg::lacosmic1d(data, uncertainty, mask, 4.5, 0.3, 5.,
+                                      4, 0., ex);
+        benchmark::DoNotOptimize(result);
+    }
+}
+
+BENCHMARK(bm_medfilt_alloc)->Arg(1000);
+BENCHMARK(bm_medfilt_workspace)->Arg(1000);
+BENCHMARK(bm_medfilt1d)->Args({10000, 7})->Args({10000, 101});
+BENCHMARK(bm_medfilt1d_network)->Arg(10000);
+BENCHMARK(bm_lacosmic1d)->Arg(10000);
+
+} // namespace
+
+BENCHMARK_MAIN();
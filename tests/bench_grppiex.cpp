@@ -0,0 +1,132 @@
+#include <benchmark/benchmark.h>
+
+#include "utils/container.h"
+#include "utils/grppiex.h"
+#include "utils/logging.h"
+#include <Eigen/Core>
+#include <optional>
+
+namespace {
+
+using Eigen::Index;
+
+// number of rows of the matrix inputs
+constexpr Index n_rows = 1000;
+
+void set_processed(benchmark::State &state, Index n) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * n);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * n *
+                            static_cast<int64_t>(sizeof(double)));
+}
+
+void bm_map(benchmark::State &state, const std::string &mode) {
+    const auto &ex = grppiex::shared_ex(mode);
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    Eigen::VectorXd out(n);
+    for (auto _ : state) {
+        grppi::map(ex, in.data(), in.data() + n, out.data(),
+                   [](auto x) { return x * x + 1.; });
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    set_processed(state, n);
+}
+
+void bm_reduce(benchmark::State &state, const std::string &mode) {
+    const auto &ex = grppiex::shared_ex(mode);
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    for (auto _ : state) {
+        auto sum = grppi::reduce(ex, in.data(), in.data() + n, 0.,
+                                 std::plus<>{});
+        benchmark::DoNotOptimize(sum);
+    }
+    set_processed(state, n);
+}
+
+void bm_map_reduce(benchmark::State &state, const std::string &mode) {
+    const auto &ex = grppiex::shared_ex(mode);
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    for (auto _ : state) {
+        auto sum = grppi::map_reduce(ex, in.data(), in.data() + n, 0.,
+                                     [](auto x) { return x * x; },
+                                     std::plus<>{});
+        benchmark::DoNotOptimize(sum);
+    }
+    set_processed(state, n);
+}
+
+// per-column reduction of a matrix of n_rows rows
+void bm_map_colwise(benchmark::State &state, const std::string &mode) {
+    const auto &ex = grppiex::shared_ex(mode);
+    const Index n_cols = std::max<Index>(state.range(0) / n_rows, 1);
+    Eigen::MatrixXd in = Eigen::MatrixXd::Random(n_rows, n_cols);
+    Eigen::VectorXd out(n_cols);
+    auto cols = container_utils::index(n_cols);
+    for (auto _ : state) {
+        grppi::map(ex, cols.begin(), cols.end(), out.data(),
+                   [&in](auto j) { return in.col(j).squaredNorm(); });
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    set_processed(state, in.size());
+}
+
+// stream the matrix columns through a two stage pipeline
+void bm_pipeline(benchmark::State &state, const std::string &mode) {
+    const auto &ex = grppiex::shared_ex(mode);
+    const Index n_cols = std::max<Index>(state.range(0) / n_rows, 1);
+    Eigen::MatrixXd in = Eigen::MatrixXd::Random(n_rows, n_cols);
+    for (auto _ : state) {
+        Index j = 0;
+        double sum = 0;
+        grppi::pipeline(
+            ex,
+            [&]() -> std::optional<Index> {
+                if (j < n_cols) {
+                    return j++;
+                }
+                return {};
+            },
+            [&in](Index j) { return in.col(j).squaredNorm(); },
+            [&sum](double x) { sum += x; });
+        benchmark::DoNotOptimize(sum);
+    }
+    set_processed(state, in.size());
+}
+
+// the modes without execution object are skipped, and the inputs are up to
+// 1e7 doubles (80 MB) per vector
+template <typename Func>
+void register_modes(std::string_view name, Func &&func) {
+    for (const auto &mode : grppiex::modes::names()) {
+        if (!grppiex::shared_ex(mode).has_execution()) {
+            continue;
+        }
+        benchmark::RegisterBenchmark(
+            fmt::format("{}/{}", name, mode).c_str(), func, mode)
+            ->RangeMultiplier(10)
+            ->Range(1000, 10000000)
+            ->UseRealTime()
+            ->Unit(benchmark::kMicrosecond);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    logging::init<>(true);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    register_modes("map", bm_map);
+    register_modes("reduce", bm_reduce);
+    register_modes("map_reduce", bm_map_reduce);
+    register_modes("map_colwise", bm_map_colwise);
+    register_modes("pipeline", bm_pipeline);
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <benchmark/benchmark.h>
+
+#include "utils/algorithm/binning.h"
+#include "utils/algorithm/ei_medfilt.h"
+#include "utils/algorithm/ei_stats.h"
+#include "utils/algorithm/lacosmic1d.h"
+
+namespace {
+
+using Eigen::Index;
+
+// size of the median window
+constexpr Index window = 7;
+
+void set_processed(benchmark::State &state, Index n) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * n);
+}
+
+// sliding median that allocates per window position
+void bm_medfilt_alloc(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    Eigen::VectorXd out(n - window + 1);
+    for (auto _ : state) {
+        for (Index i = 0; i < out.size(); ++i) {
+            out.coeffRef(i) = alg::median(in.segment(i, window));
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_processed(state, n);
+}
+
+// sliding median with reused workspace
+void bm_medfilt_workspace(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    Eigen::VectorXd out(n - window + 1);
+    std::vector<double> workspace;
+    workspace.reserve(window);
+    for (auto _ : state) {
+        for (Index i = 0; i < out.size(); ++i) {
+            out.coeffRef(i) = alg::median(in.segment(i, window), workspace);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_processed(state, n);
+}
+
+// running median filter of window size given by the second argument
+void bm_medfilt1d(benchmark::State &state) {
+    const Index n = state.range(0);
+    const Index size = state.range(1);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    for (auto _ : state) {
+        auto out = alg::medfilt1d(in, size);
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_processed(state, n);
+}
+
+// median filter of compile-time window size using the median network
+void bm_medfilt1d_network(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    for (auto _ : state) {
+        auto out = alg::medfilt1d<window>(in);
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_processed(state, n);
+}
+
+// histogram in 1000 uniform or variable bins
+template <typename Bins>
+void bm_histogram(benchmark::State &state, const Bins &bins) {
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(n);
+    const auto &ex = grppiex::shared_ex();
+    for (auto _ : state) {
+        auto counts = alg::histogram(ex, bins, in);
+        benchmark::DoNotOptimize(counts.data());
+    }
+    set_processed(state, n);
+}
+
+void bm_downsample(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(1 << 22);
+    for (auto _ : state) {
+        auto out = alg::downsample(in, n);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            in.size() * sizeof(double));
+}
+
+void bm_downsample_reshaped(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd in = Eigen::VectorXd::Random(1 << 22);
+    for (auto _ : state) {
+        Eigen::VectorXd out =
+            Eigen::Map<const Eigen::MatrixXd>(in.data(), n, in.size() / n)
+                .colwise()
+                .sum()
+                .transpose();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            in.size() * sizeof(double));
+}
+
+void bm_lacosmic1d(benchmark::State &state) {
+    const Index n = state.range(0);
+    Eigen::VectorXd data = Eigen::VectorXd::Random(n);
+    Eigen::VectorXd uncertainty = Eigen::VectorXd::Ones(n);
+    Eigen::VectorXb mask = Eigen::VectorXb::Zero(n);
+    const auto &ex = grppiex::shared_ex("seq");
+    for (auto _ : state) {
+        auto result = alg::lacosmic1d(data, uncertainty, mask, 4.5, 0.3, 5.,
+                                      4, 0., ex);
+        benchmark::DoNotOptimize(result);
+    }
+    set_processed(state, n);
+}
+
+BENCHMARK(bm_medfilt_alloc)
+    ->Range(1000, 1000000)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(bm_medfilt_workspace)
+    ->Range(1000, 1000000)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(bm_medfilt1d)
+    ->Ranges({{10000, 1000000}, {7, 1001}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(bm_medfilt1d_network)
+    ->Range(10000, 1000000)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(bm_histogram, uniform, alg::UniformBins{1000, -1., 1.})
+    ->Range(10000, 10000000)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(bm_histogram, edges,
+                  alg::EdgeBins{Eigen::VectorXd::LinSpaced(1001, -1., 1.)})
+    ->Range(10000, 10000000)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(bm_downsample)->RangeMultiplier(2)->Range(2, 32)->Arg(3);
+BENCHMARK(bm_downsample_reshaped)->RangeMultiplier(2)->Range(2, 32);
+BENCHMARK(bm_lacosmic1d)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -1,13 +1,23 @@
 #include <benchmark/benchmark.h>
 #include <gtest/gtest.h>
 
+#include "utils/algorithm/ei_detect1d.h"
 #include "utils/algorithm/ei_linspaced.h"
 #include "utils/algorithm/ei_polyfit.h"
+#include "utils/algorithm/binning.h"
+#include "utils/algorithm/ei_medfilt.h"
+#include "utils/algorithm/ei_searchsorted.h"
 #include "utils/algorithm/ei_stats.h"
+#include "utils/algorithm/tdigest.h"
 #include "utils/formatter/container.h"
 #include "utils/formatter/enum.h"
 #include "utils/formatter/matrix.h"
 #include "utils/grppiex.h"
+#include "utils/grppiex/async.h"
+#include "utils/grppiex/grain.h"
+#include "utils/grppiex/placement.h"
+#include "utils/grppiex/reduce.h"
+#include "utils/grppiex/telemetry.h"
 #include "utils/container.h"
 #include <CCfits/CCfits>
 
@@ -34,6 +44,266 @@ TEST(grppiex, modes) {
     EXPECT_NO_THROW(ms::dyn_ex(grppiex::Mode::seq));
 }
 
+TEST(grppiex, registry) {
+    auto &registry = grppiex::Registry::instance();
+    const auto &ex0 = grppiex::shared_ex(grppiex::Mode::seq);
+    EXPECT_EQ(&ex0, &grppiex::shared_ex("seq"));
+    EXPECT_EQ(&ex0, &grppiex::shared_ex(grppiex::Mode::seq, 4));
+    const auto &ex1 = grppiex::shared_ex(grppiex::Mode::par, 2);
+    EXPECT_EQ(&ex1, &grppiex::shared_ex(grppiex::Mode::par, 2));
+    auto size = registry.size();
+    EXPECT_NE(&ex1, &grppiex::shared_ex(grppiex::Mode::par, 3));
+    EXPECT_EQ(registry.size(), size + 1);
+    auto data = container_utils::index(100);
+    EXPECT_EQ(grppi::reduce(ex1, data, 0, std::plus<>{}), 4950);
+    // the references stay valid after shutdown
+    grppiex::shutdown();
+    EXPECT_EQ(registry.size(), size + 1);
+    EXPECT_EQ(&ex1, &grppiex::shared_ex(grppiex::Mode::par, 2));
+    EXPECT_EQ(grppi::reduce(ex1, data, 0, std::plus<>{}), 4950);
+}
+
+TEST(grppiex, grain) {
+    const auto &ex = grppiex::shared_ex();
+    for (auto grain : {grppiex::Grain::fixed(7), grppiex::Grain::auto_()}) {
+        for (std::ptrdiff_t n : {0, 1, 100, 10000}) {
+            std::vector<int> count(static_cast<std::size_t>(n), 0);
+            grppiex::for_each_index(
+                ex, n, [&](auto i) { ++count[static_cast<std::size_t>(i)]; },
+                grain);
+            EXPECT_TRUE(std::all_of(count.begin(), count.end(),
+                                    [](auto c) { return c == 1; }));
+        }
+        EXPECT_TRUE(grain.is_tuned());
+        EXPECT_GT(grain.size(), 0);
+    }
+}
+
+TEST(grppiex, telemetry) {
+    auto data = container_utils::index(100);
+    auto iex = grppiex::instrument(grppiex::shared_ex());
+    auto sum = grppi::map_reduce(
+        iex.ex(), data.begin(), data.end(), 0,
+        iex.wrap([](auto i) { return i; }), std::plus<>{});
+    EXPECT_EQ(sum, 4950);
+    auto s = iex.snapshot();
+    SPDLOG_TRACE("telemetry: {}", s);
+    EXPECT_EQ(s.n_tasks, data.size());
+    EXPECT_GE(s.imbalance, 1.);
+    iex.reset();
+    EXPECT_EQ(iex.snapshot().n_tasks, 0u);
+    // disabled
+    auto iex0 = grppiex::instrument<false>(grppiex::shared_ex());
+    grppi::map(iex0.ex(), data, data, iex0.wrap([](auto i) { return i; }));
+    EXPECT_EQ(iex0.snapshot().n_tasks, 0u);
+}
+
+TEST(grppiex, async) {
+    auto data = container_utils::index(100);
+    std::vector<int> out(data.size());
+    const auto &ex = grppiex::shared_ex();
+    auto fm = grppiex::async_map(ex, data, out, [](auto i) { return 2 * i; });
+    auto fs = fm.then([&]() {
+                    return grppi::map_reduce(ex, out.begin(), out.end(), 0,
+                                             [](auto i) { return i; },
+                                             std::plus<>{});
+                }).then([](auto sum) { return sum / 2; });
+    EXPECT_EQ(fs.get(), 4950);
+    EXPECT_TRUE(fm.is_ready());
+    auto fr = grppiex::async_map_reduce(ex, data.begin(), data.end(), 0,
+                                        [](auto i) { return i; },
+                                        std::plus<>{});
+    EXPECT_EQ(fr.get(), 4950);
+    auto fe = grppiex::async([]() -> int {
+                  throw std::runtime_error("async error");
+              }).then([](auto i) { return i + 1; });
+    EXPECT_THROW(fe.get(), std::runtime_error);
+}
+
+TEST(grppiex, async_then) {
+    using ids_t = std::vector<std::thread::id>;
+    const auto caller = std::this_thread::get_id();
+    for (auto mode : {grppiex::Mode::seq, grppiex::Mode::thr}) {
+        const auto &ex = grppiex::shared_ex(mode);
+        // chained continuations record the threads they run on
+        ids_t ids;
+        std::mutex mutex;
+        auto f = grppiex::async(ex, []() { return 1; });
+        for (int i = 0; i < 100; ++i) {
+            f = f.then([&](int x) {
+                std::scoped_lock lock(mutex);
+                ids.push_back(std::this_thread::get_id());
+                return x + 1;
+            });
+        }
+        EXPECT_EQ(f.get(), 101);
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        if (mode == grppiex::Mode::seq) {
+            // inline on the calling thread
+            EXPECT_EQ(ids, ids_t{caller});
+        } else {
+            // on the pool of the concurrency of ex
+            EXPECT_LE(ids.size(), grppiex::Registry::instance()
+                                      .pool(grppiex::concurrency(ex))
+                                      .size());
+            EXPECT_EQ(std::count(ids.begin(), ids.end(), caller), 0);
+        }
+        // continuations registered before the result is set
+        std::promise<void> gate;
+        auto g = grppiex::async([gate = gate.get_future().share()]() {
+            gate.wait();
+            return 1;
+        });
+        for (int i = 0; i < 10; ++i) {
+            g = g.then(ex, [](int x) { return x + 1; });
+        }
+        EXPECT_FALSE(g.is_ready());
+        gate.set_value();
+        EXPECT_EQ(g.get(), 11);
+    }
+    // at most as many tasks run at once as the concurrency of ex
+    const auto &ex2 = grppiex::shared_ex(grppiex::Mode::thr, 2);
+    std::atomic<int> n_running{0};
+    std::atomic<int> n_max{0};
+    std::vector<grppiex::Future<void>> fs;
+    for (int i = 0; i < 8; ++i) {
+        fs.push_back(grppiex::async(ex2, [&]() {
+            auto n = ++n_running;
+            auto m = n_max.load();
+            while (n > m && !n_max.compare_exchange_weak(m, n)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            --n_running;
+        }));
+    }
+    for (auto &f : fs) {
+        f.wait();
+    }
+    EXPECT_LE(n_max.load(), 2);
+    // continuations of a plain future run on the waiting thread
+    std::promise<int> plain;
+    grppiex::Future<int> fp{plain.get_future()};
+    auto fc = fp.then(
+        [](int x) { return std::make_pair(x, std::this_thread::get_id()); });
+    plain.set_value(1);
+    EXPECT_EQ(fc.get(), std::make_pair(1, caller));
+    // the pools are joined on shutdown and created again on request
+    grppiex::shutdown();
+    EXPECT_EQ(grppiex::async(ex2, []() { return 2; }).get(), 2);
+}
+
+TEST(grppiex, reproducible_reduce) {
+    // values of varying magnitude so that the sum depends on the order
+    std::vector<double> data(100003);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = std::pow(-1., i) * std::pow(10., i % 17) / (i + 1.);
+    }
+    auto sum0 = grppiex::reproducible_reduce(grppiex::shared_ex("seq"), data,
+                                             0., std::plus<>{});
+    auto sq0 = grppiex::reproducible_map_reduce(
+        grppiex::shared_ex("seq"), data.begin(), data.end(), 0.,
+        [](auto x) { return x * x; }, std::plus<>{});
+    for (const auto &name : grppiex::modes::names()) {
+        for (int concurrency : {0, 2, 3}) {
+            const auto &ex = grppiex::shared_ex(name, concurrency);
+            EXPECT_EQ(grppiex::reproducible_reduce(ex, data, 0.,
+                                                   std::plus<>{}),
+                      sum0);
+            EXPECT_EQ(grppiex::reproducible_map_reduce(
+                          ex, data, 0., [](auto x) { return x * x; },
+                          std::plus<>{}),
+                      sq0);
+        }
+    }
+    EXPECT_EQ(grppiex::reproducible_reduce(grppiex::shared_ex(),
+                                           std::vector<double>{}, 1.,
+                                           std::plus<>{}),
+              1.);
+}
+
+TEST(grppiex, budget) {
+    auto &budget = grppiex::Budget::instance();
+    auto total = budget.total();
+    EXPECT_FALSE(budget.is_nested());
+    EXPECT_EQ(budget.share(), total);
+    budget.set_total(8);
+    const auto &seq = grppiex::shared_ex(grppiex::Mode::seq);
+    // tasks use all the share, nested requests are sequential
+    grppiex::budget_region([&]() {
+        EXPECT_TRUE(budget.is_nested());
+        EXPECT_EQ(budget.share(), 1);
+        EXPECT_EQ(&grppiex::shared_ex(grppiex::Mode::par), &seq);
+        EXPECT_EQ(&grppiex::shared_ex(grppiex::Mode::par, 4), &seq);
+        EXPECT_NO_THROW(grppiex::dyn_ex(grppiex::Mode::par));
+    })();
+    // tasks share the budget
+    grppiex::budget_region(2, [&]() {
+        EXPECT_EQ(budget.share(), 4);
+        EXPECT_EQ(&grppiex::shared_ex(grppiex::Mode::par),
+                  &grppiex::shared_ex(grppiex::Mode::par, 4));
+        EXPECT_EQ(&grppiex::shared_ex(grppiex::Mode::par, 8),
+                  &grppiex::shared_ex(grppiex::Mode::par, 4));
+        grppiex::budget_region(4, [&]() {
+            EXPECT_EQ(budget.share(), 1);
+        })();
+        EXPECT_EQ(budget.share(), 4);
+    })();
+    EXPECT_FALSE(budget.is_nested());
+    budget.set_total(total);
+    EXPECT_EQ(grppiex::concurrency(seq), 1);
+    EXPECT_EQ(grppiex::concurrency(grppiex::shared_ex(grppiex::Mode::omp, 3)),
+              3);
+}
+
+TEST(grppiex, placement) {
+    using grppiex::Placement;
+    using v_t = std::vector<int>;
+    EXPECT_EQ(grppiex::internal::parse_cpulist("0-3,8, 10-11"),
+              (v_t{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(grppiex::internal::parse_cpulist("5"), v_t{5});
+    EXPECT_TRUE(grppiex::internal::parse_cpulist("").empty());
+    // two nodes of uneven size
+    std::vector<v_t> nodes{{0, 1, 2, 3}, {4, 5}};
+    Placement compact{Placement::Policy::compact};
+    Placement scatter{Placement::Policy::scatter};
+    EXPECT_EQ(compact.resolve(3, nodes), (v_t{0, 1, 2}));
+    EXPECT_EQ(compact.resolve(8, nodes), (v_t{0, 1, 2, 3, 4, 5}));
+    EXPECT_EQ(scatter.resolve(3, nodes), (v_t{0, 4, 1}));
+    EXPECT_EQ(scatter.resolve(8, nodes), (v_t{0, 4, 1, 5, 2, 3}));
+    EXPECT_THROW(compact.resolve(0, nodes), std::runtime_error);
+    EXPECT_THROW(scatter.resolve(-1, nodes), std::runtime_error);
+    EXPECT_TRUE(Placement{}.resolve(4).empty());
+    EXPECT_EQ((Placement{Placement::Policy::list, {1, 2, 3}}.resolve(2)),
+              (v_t{1, 2}));
+    // invalid cpu numbers
+    EXPECT_THROW((Placement{Placement::Policy::list, {0, -1}}.resolve()),
+                 std::runtime_error);
+    EXPECT_THROW((Placement{Placement::Policy::list, {1 << 20}}.resolve()),
+                 std::runtime_error);
+    EXPECT_THROW(grppiex::ScopedCpuset{v_t{-1}}, std::runtime_error);
+    // the cpuset is restored at the end of the scope
+    auto allowed = grppiex::internal::allowed_cpus();
+    std::thread([&]() {
+        {
+            auto cpuset = Placement{Placement::Policy::list, {allowed.front()}}
+                              .restrict_cpus();
+#if defined(__linux__)
+            EXPECT_TRUE(cpuset.is_applied());
+            EXPECT_EQ(grppiex::internal::allowed_cpus(), v_t{allowed.front()});
+#endif
+        }
+        EXPECT_EQ(grppiex::internal::allowed_cpus(), allowed);
+    }).join();
+    EXPECT_EQ(grppiex::internal::allowed_cpus(), allowed);
+    // first touch
+    auto m = grppiex::make_first_touch<Eigen::MatrixXd>(grppiex::shared_ex(),
+                                                        10, 3, 7);
+    EXPECT_EQ(m.rows(), 10);
+    EXPECT_EQ(m.cols(), 3);
+    EXPECT_TRUE(m.isZero(0));
+}
+
 TEST(utils, create) {
     auto modes = grppiex::Mode_meta::members;
     for (const auto &m : modes) {
@@ -66,6 +336,34 @@ TEST(utils, create) {
     SPDLOG_TRACE("cs: {}", cs);
 }
 
+TEST(utils, views) {
+    namespace views = container_utils::views;
+    auto r = views::iota(2, 6);
+    EXPECT_EQ(r.size(), 4u);
+    EXPECT_EQ(std::vector<int>(r.begin(), r.end()),
+              (std::vector<int>{2, 3, 4, 5}));
+    EXPECT_EQ(r.end() - r.begin(), 4);
+    EXPECT_EQ(r.begin()[3], 5);
+    std::vector<double> a{1., 2., 3.};
+    std::vector<int> b{4, 5, 6, 7};
+    for (const auto &[i, v] : views::enumerate(a)) {
+        EXPECT_EQ(v, a[i]);
+    }
+    // element references are writable
+    for (auto [x, y] : views::zip(a, b)) {
+        x += y;
+    }
+    EXPECT_EQ(a, (std::vector<double>{5., 7., 9.}));
+    EXPECT_EQ(views::zip(a, b).size(), 3u);
+    // consumed by grppi
+    auto e = views::enumerate(b);
+    auto sum = grppi::map_reduce(
+        grppiex::shared_ex(), e.begin(), e.end(), 0,
+        [](const auto &p) { return static_cast<int>(p.first) * p.second; },
+        std::plus<>{});
+    EXPECT_EQ(sum, 38);
+}
+
 TEST(alg, meanstd) {
     Eigen::VectorXd m;
     m.setLinSpaced(100, 0, 99);
@@ -81,6 +379,709 @@ TEST(alg, meanstd) {
                  mean, std, med, mad);
 }
 
+TEST(alg, median_workspace) {
+    Eigen::VectorXI n;
+    n.setLinSpaced(10, 1, 10);
+    std::vector<double> workspace;
+    EXPECT_EQ(alg::median(n, workspace), alg::median(n));
+    EXPECT_EQ(alg::median(n.head(5), workspace), 3.);
+    EXPECT_EQ(alg::medmad(n, workspace), alg::medmad(n));
+    Eigen::MatrixXd m = Eigen::MatrixXd::Random(5, 7);
+    workspace.reserve(m.size());
+    auto data = workspace.data();
+    EXPECT_EQ(alg::medmad(m, workspace), alg::medmad(m));
+    EXPECT_EQ(workspace.data(), data);
+}
+
+TEST(alg, medfilt1d) {
+    alg::RunningMedian<int> rm;
+    for (auto x : {5, 1, 4, 2}) {
+        rm.push(x);
+    }
+    EXPECT_EQ(rm.median(), 3.);
+    rm.replace(1, 9);
+    EXPECT_EQ(rm.median(), 4.5);
+    rm.pop(9);
+    EXPECT_EQ(rm.median(), 4.);
+    EXPECT_THROW(rm.pop(9), std::runtime_error);
+
+    using Eigen::Index;
+    Eigen::VectorXd data = (Eigen::VectorXd::Random(500) * 10).array().round();
+    auto check = [&data](auto mode, Index size) {
+        constexpr auto mode_ = decltype(mode)::value;
+        auto padded = alg::borderpad1d<mode_>(data, size);
+        Eigen::VectorXd expected(data.size());
+        for (Index i = 0; i < data.size(); ++i) {
+            expected.coeffRef(i) = alg::median(padded.segment(i, size));
+        }
+        EXPECT_EQ(alg::medfilt1d<mode_>(data, size), expected);
+        EXPECT_EQ(alg::medfilt1d<mode_>(grppiex::dyn_ex("omp"), data, size, 10),
+                  expected);
+    };
+    for (Index size : {2, 3, 5, 7, 50, 51}) {
+        check(std::integral_constant<alg::BorderMode,
+                                     alg::BorderMode::Mirror>{},
+              size);
+        check(std::integral_constant<alg::BorderMode,
+                                     alg::BorderMode::Nearest>{},
+              size);
+    }
+    EXPECT_EQ(alg::medfilt1d(data, 1), data);
+    EXPECT_THROW(alg::medfilt1d(data, 501), std::runtime_error);
+
+    // border values, with the window centered at each border sample
+    Eigen::VectorXd small(7);
+    small << 1, 5, 2, 8, 3, 9, 4;
+    Eigen::VectorXd expected(7);
+    expected << 2, 5, 3, 5, 4, 8, 4;
+    EXPECT_EQ(alg::medfilt1d(small, 5), expected);
+    EXPECT_EQ(alg::medfilt1d<5>(small), expected);
+    expected << 1, 2, 3, 5, 4, 4, 4;
+    EXPECT_EQ(alg::medfilt1d<alg::BorderMode::Nearest>(small, 5), expected);
+    // the tail is padded for even window sizes
+    expected << 3, 3.5, 5, 5.5, 6, 6.5, 6.5;
+    EXPECT_EQ(alg::medfilt1d(small, 2), expected);
+    // window of the data size
+    Eigen::VectorXd head = small.head(5);
+    expected.resize(5);
+    expected << 2, 5, 3, 5, 3;
+    EXPECT_EQ(alg::medfilt1d(head, 5), expected);
+    EXPECT_EQ(alg::medfilt1d<5>(head), expected);
+
+    // NaN values are skipped
+    constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+    alg::RunningMedian<double> nanrm;
+    nanrm.push(nan);
+    EXPECT_TRUE(nanrm.empty());
+    EXPECT_TRUE(std::isnan(nanrm.median()));
+    nanrm.replace(nan, 1.);
+    nanrm.push(3.);
+    EXPECT_EQ(nanrm.median(), 2.);
+    nanrm.replace(3., nan);
+    EXPECT_EQ(nanrm.size(), 1);
+    EXPECT_EQ(nanrm.median(), 1.);
+    for (Index i = 3; i < data.size(); i += 4) {
+        data.coeffRef(i) = nan;
+    }
+    data.segment(200, 20).setConstant(nan);
+    auto padded = alg::borderpad1d<alg::BorderMode::Mirror>(data, 7);
+    expected.resize(data.size());
+    for (Index i = 0; i < data.size(); ++i) {
+        expected.coeffRef(i) = alg::nanmedian(padded.segment(i, 7));
+    }
+    EXPECT_TRUE(expected.segment(203, 14).array().isNaN().all());
+    auto same = [&expected](const auto &filtered) {
+        return ((filtered.array().isNaN() && expected.array().isNaN()) ||
+                filtered.array() == expected.array())
+            .all();
+    };
+    EXPECT_TRUE(same(alg::medfilt1d(data, 7)));
+    EXPECT_TRUE(same(alg::medfilt1d<7>(grppiex::dyn_ex("omp"), data, 100)));
+}
+
+TEST(alg, median_network) {
+    auto check = [](auto size_) {
+        constexpr auto size = decltype(size_)::value;
+        // all orderings of values with duplicates
+        Eigen::Matrix<Eigen::Index, size, 1> v;
+        for (int i = 0; i < size; ++i) {
+            v.coeffRef(i) = i / 2;
+        }
+        std::sort(v.data(), v.data() + size);
+        do {
+            EXPECT_EQ(alg::median(v), alg::median(Eigen::VectorXI(v)));
+        } while (std::next_permutation(v.data(), v.data() + size));
+        Eigen::VectorXd data = Eigen::VectorXd::Random(1000);
+        EXPECT_EQ(alg::medfilt1d<size>(data), alg::medfilt1d(data, size));
+        EXPECT_EQ((alg::medfilt1d<size, alg::BorderMode::Nearest>(
+                      grppiex::dyn_ex("omp"), data, 300)),
+                  alg::medfilt1d<alg::BorderMode::Nearest>(data, size));
+    };
+    check(std::integral_constant<Eigen::Index, 3>{});
+    check(std::integral_constant<Eigen::Index, 5>{});
+    check(std::integral_constant<Eigen::Index, 7>{});
+    check(std::integral_constant<Eigen::Index, 9>{});
+    check(std::integral_constant<Eigen::Index, 11>{});
+}
+
+TEST(alg, moments) {
+    Eigen::VectorXd m = Eigen::VectorXd::Random(1000).array() + 1e6;
+    auto mean = m.mean();
+    auto dev = (m.array() - mean).eval();
+    auto var = dev.square().mean();
+    auto mom = alg::moments<4>(m);
+    EXPECT_EQ(mom.count, m.size());
+    EXPECT_NEAR(mom.mean, mean, 1e-9);
+    EXPECT_NEAR(mom.variance(), var, 1e-9);
+    EXPECT_NEAR(mom.variance(1), var * 1000 / 999, 1e-9);
+    EXPECT_NEAR(mom.skewness(), dev.cube().mean() / std::pow(var, 1.5), 1e-6);
+    EXPECT_NEAR(mom.kurtosis(), dev.square().square().mean() / (var * var) - 3,
+                1e-6);
+    // merged and pushed moments agree
+    auto lhs = alg::moments<4>(m.head(333));
+    auto rhs = alg::moments<4>(m.tail(667));
+    auto merged = lhs + rhs;
+    EXPECT_NEAR(merged.mean, mom.mean, 1e-9);
+    EXPECT_NEAR(merged.M2, mom.M2, 1e-6);
+    EXPECT_NEAR(merged.M3, mom.M3, 1e-6);
+    EXPECT_NEAR(merged.M4, mom.M4, 1e-6);
+    alg::Moments<> pushed{};
+    for (auto x : m) {
+        pushed.push(x);
+    }
+    EXPECT_NEAR(pushed.mean, mom.mean, 1e-9);
+    EXPECT_NEAR(pushed.M2, mom.M2, 1e-6);
+    // parallel and matrix
+    Eigen::MatrixXd mat = Eigen::MatrixXd::Random(30, 200);
+    auto matmean = mat.mean();
+    auto matvar = (mat.array() - matmean).square().mean();
+    for (const auto &mode : {"seq", "omp"}) {
+        auto pmom = alg::moments(grppiex::dyn_ex(mode), mat, 100);
+        EXPECT_EQ(pmom.count, mat.size());
+        EXPECT_NEAR(pmom.mean, matmean, 1e-12);
+        EXPECT_NEAR(pmom.variance(), matvar, 1e-12);
+        auto tmom = alg::moments(grppiex::dyn_ex(mode), mat.transpose(), 100);
+        EXPECT_NEAR(tmom.variance(), matvar, 1e-12);
+    }
+    static_assert(std::is_trivially_copyable_v<alg::Moments<4>>);
+}
+
+TEST(alg, nanstats) {
+    constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+    Eigen::MatrixXd m(3, 4);
+    m << 1, nan, 3, nan, 4, nan, 6, 2, nan, nan, 0, 5;
+    EXPECT_EQ(alg::nancount(m), 7);
+    EXPECT_EQ(alg::nansum(m), 21.);
+    EXPECT_EQ(alg::nanmean(m), 3.);
+    EXPECT_DOUBLE_EQ(alg::nanstd(m), 2.);
+    EXPECT_DOUBLE_EQ(alg::nanstd(m, 1), std::sqrt(28. / 6));
+    EXPECT_EQ(alg::nanmin(m), 0.);
+    EXPECT_EQ(alg::nanmax(m), 6.);
+    EXPECT_EQ(alg::nanmedian(m), 3.);
+    EXPECT_TRUE(std::isnan(alg::nanmean(m.col(1))));
+    EXPECT_TRUE(std::isnan(alg::nanmin(m.col(1))));
+    // axis
+    auto colmean = alg::nanmean<alg::Axis::Colwise>(m);
+    EXPECT_EQ(colmean.size(), 4);
+    EXPECT_EQ(colmean.coeff(0), 2.5);
+    EXPECT_TRUE(std::isnan(colmean.coeff(1)));
+    EXPECT_EQ(colmean.coeff(2), 3.);
+    auto [rowmean, rowstd] = alg::nanmeanstd<alg::Axis::Rowwise>(m);
+    EXPECT_EQ(rowmean, Eigen::Vector3d(2., 4., 2.5));
+    EXPECT_DOUBLE_EQ(rowstd.coeff(1), std::sqrt(8. / 3));
+    EXPECT_EQ(alg::nansum<alg::Axis::Rowwise>(m), Eigen::Vector3d(4., 12., 5.));
+    auto colmax = alg::nanmax<alg::Axis::Colwise>(m);
+    EXPECT_EQ(colmax.coeff(3), 5.);
+    EXPECT_TRUE(std::isnan(colmax.coeff(1)));
+    EXPECT_EQ(alg::nanmin<alg::Axis::Rowwise>(m), Eigen::Vector3d(1., 2., 0.));
+    // compaction
+    std::vector<double> buffer;
+    auto valid = alg::nancompact(m, buffer);
+    EXPECT_EQ(valid.size(), 7);
+    EXPECT_EQ(buffer, (std::vector<double>{1, 4, 3, 6, 0, 2, 5}));
+    EXPECT_EQ(alg::nanmedmad(m, buffer), alg::nanmedmad(m));
+    // blocks with and without NaN
+    Eigen::MatrixXd big = Eigen::MatrixXd::Random(700, 3);
+    big.col(1).segment(300, 10).setConstant(nan);
+    big.coeffRef(650, 2) = nan;
+    std::vector<double> expected;
+    for (Eigen::Index i = 0; i < big.size(); ++i) {
+        if (!std::isnan(big.data()[i])) {
+            expected.push_back(big.data()[i]);
+        }
+    }
+    alg::nancompact(big, buffer);
+    EXPECT_EQ(buffer, expected);
+    auto [bigmean, bigstd] = alg::nanmeanstd(big, 1);
+    auto mom = alg::moments(eigen_utils::asvec(expected));
+    EXPECT_NEAR(bigmean, mom.mean, 1e-12);
+    EXPECT_NEAR(bigstd, mom.stddev(1), 1e-12);
+    auto [nanmean_, nanstd_] = alg::nanmeanstd(m.col(1));
+    EXPECT_TRUE(std::isnan(nanmean_));
+    EXPECT_TRUE(std::isnan(nanstd_));
+}
+
+TEST(alg, axis_stats) {
+    using alg::Axis;
+    Eigen::MatrixXd m = Eigen::MatrixXd::Random(51, 200);
+    Eigen::VectorXd colmean(m.cols());
+    Eigen::VectorXd colstd(m.cols());
+    Eigen::VectorXd colmed(m.cols());
+    Eigen::VectorXd colmad(m.cols());
+    for (Eigen::Index j = 0; j < m.cols(); ++j) {
+        std::tie(colmean.coeffRef(j), colstd.coeffRef(j)) =
+            alg::meanstd(m.col(j), 1);
+        std::tie(colmed.coeffRef(j), colmad.coeffRef(j)) =
+            alg::medmad(m.col(j));
+    }
+    Eigen::VectorXd rowmed(m.rows());
+    for (Eigen::Index i = 0; i < m.rows(); ++i) {
+        rowmed.coeffRef(i) = alg::median(m.row(i));
+    }
+    for (const auto &mode : {"seq", "omp"}) {
+        const auto &ex = grppiex::shared_ex(mode);
+        EXPECT_TRUE(alg::mean<Axis::Colwise>(ex, m).isApprox(colmean));
+        EXPECT_TRUE(alg::mean<Axis::Rowwise>(ex, m).isApprox(
+            m.rowwise().mean()));
+        auto [mean, std] = alg::meanstd<Axis::Colwise>(ex, m, 1);
+        EXPECT_TRUE(mean.isApprox(colmean));
+        EXPECT_TRUE(std.isApprox(colstd));
+        EXPECT_EQ(alg::median<Axis::Rowwise>(ex, m), rowmed);
+        // write into existing output
+        Eigen::VectorXd med(m.cols());
+        Eigen::ArrayXd mad;
+        alg::medmad<Axis::Colwise>(ex, m, med, mad);
+        EXPECT_EQ(med, colmed);
+        EXPECT_EQ(mad.matrix(), colmad);
+        Eigen::VectorXd wrong(1);
+        EXPECT_THROW(alg::median<Axis::Colwise>(ex, m, wrong),
+                     std::runtime_error);
+    }
+    EXPECT_EQ(alg::median<Axis::Colwise>(m), colmed);
+    // the workspace holds the fractional deviations of integral data
+    Eigen::MatrixXI mi = (m * 10).cast<Eigen::Index>();
+    Eigen::VectorXd med(mi.cols());
+    Eigen::VectorXd mad(mi.cols());
+    alg::medmad<Axis::Colwise>(grppiex::dyn_ex("seq"), mi, med, mad);
+    for (Eigen::Index j = 0; j < mi.cols(); ++j) {
+        EXPECT_EQ(std::make_pair(med.coeff(j), mad.coeff(j)),
+                  alg::medmad(mi.col(j)));
+    }
+}
+
+TEST(alg, tdigest) {
+    using Eigen::Index;
+    const Index n = 100000;
+    Eigen::VectorXd data = Eigen::VectorXd::Random(n);
+    std::vector<double> sorted(data.data(), data.data() + n);
+    std::sort(sorted.begin(), sorted.end());
+    auto exact = [&](double q) {
+        return sorted[static_cast<std::size_t>(q * (n - 1))];
+    };
+    alg::TDigest digest;
+    digest.insert(data);
+    EXPECT_EQ(digest.count(), n);
+    EXPECT_LT(digest.centroids().size(), 200);
+    for (auto q : {0.001, 0.01, 0.1, 0.5, 0.9, 0.99, 0.999}) {
+        EXPECT_NEAR(digest.quantile(q), exact(q), 0.005);
+    }
+    EXPECT_EQ(digest.quantile(0), sorted.front());
+    EXPECT_EQ(digest.quantile(1), sorted.back());
+    EXPECT_TRUE(std::isnan(alg::TDigest{}.median()));
+    // merged from blocks with map_reduce
+    const Index block_size = 1000;
+    auto blocks = container_utils::views::iota(n / block_size);
+    auto merged = grppi::map_reduce(
+        grppiex::dyn_ex("omp"), blocks.begin(), blocks.end(), alg::TDigest{},
+        [&](Index i) {
+            alg::TDigest d;
+            return d.insert(data.segment(i * block_size, block_size));
+        },
+        std::plus<>{});
+    EXPECT_EQ(merged.count(), n);
+    for (auto q : {0.01, 0.5, 0.99}) {
+        EXPECT_NEAR(merged.quantile(q), exact(q), 0.005);
+    }
+    // serialize
+    auto restored = alg::TDigest::deserialize(merged.serialize());
+    EXPECT_EQ(restored.count(), merged.count());
+    EXPECT_EQ(restored.median(), merged.median());
+    EXPECT_THROW(alg::TDigest::deserialize("bad"), std::runtime_error);
+    // const queries merge the pending values in place
+    alg::TDigest pending;
+    pending.insert(data.head(100));
+    const auto &cpending = pending;
+    auto median = cpending.median();
+    pending.compress();
+    EXPECT_EQ(pending.median(), median);
+    EXPECT_EQ(cpending.centroids().size(), pending.centroids().size());
+    // compressions have to match
+    EXPECT_THROW(alg::TDigest{50}.merge(digest), std::runtime_error);
+    EXPECT_THROW(alg::TDigest{50} + alg::TDigest{}, std::runtime_error);
+}
+
+TEST(alg, searchsorted) {
+    using alg::Side;
+    Eigen::VectorXd s(6);
+    s << 0., 1., 1., 2., 4., 8.;
+    EXPECT_EQ(alg::searchsorted(s, 1.), 1);
+    EXPECT_EQ(alg::searchsorted<Side::Right>(s, 1.), 3);
+    EXPECT_EQ(alg::searchsorted(s, -1.), 0);
+    EXPECT_EQ(alg::searchsorted(s, 9.), 6);
+    // batch of sorted and unsorted queries agree with single queries
+    Eigen::VectorXd sorted_values = Eigen::VectorXd::LinSpaced(50, -1., 9.);
+    Eigen::VectorXd values = sorted_values.reverse();
+    auto check = [&s](const auto &values) {
+        auto left = alg::searchsorted(s, values);
+        auto right = alg::searchsorted<Side::Right>(s, values);
+        for (Eigen::Index i = 0; i < values.size(); ++i) {
+            EXPECT_EQ(left.coeff(i), alg::searchsorted(s, values.coeff(i)));
+            EXPECT_EQ(right.coeff(i),
+                      alg::searchsorted<Side::Right>(s, values.coeff(i)));
+        }
+    };
+    check(sorted_values);
+    check(values);
+    check(Eigen::VectorXd(s));
+    // agree with the linear versions
+    Eigen::VectorXd t = Eigen::VectorXd::LinSpaced(1000, 0., 99.9);
+    for (auto v : {-1., 0., 3.14, 50.05, 99.9, 120.}) {
+        EXPECT_EQ(alg::argeq_sorted(t, v), alg::argeq(t, v));
+        EXPECT_EQ(alg::argwithin_sorted(t, v, v + 10.),
+                  alg::argwithin(t, v, v + 10.));
+    }
+    EXPECT_EQ(alg::argwithin_sorted(s, 1., 2.), std::make_pair(Eigen::Index{1},
+                                                             Eigen::Index{4}));
+    // ranges outside of the data and inverted ranges
+    for (auto [vmin, vmax] : std::vector<std::pair<double, double>>{
+             {-5., -1.}, {9., 20.}, {-1., 20.}, {3., 1.}, {8., 0.}, {5., 6.}}) {
+        EXPECT_EQ(alg::argwithin_sorted(s, vmin, vmax),
+                  alg::argwithin(s, vmin, vmax));
+        EXPECT_EQ(alg::argwithin_sorted(t, vmin * 20., vmax * 20.),
+                  alg::argwithin(t, vmin * 20., vmax * 20.));
+    }
+    // ties resolve to the first duplicate
+    Eigen::VectorXd d(3);
+    d << 1., 1., 2.;
+    for (auto v : {0., 1., 1.2, 1.5, 1.8, 3.}) {
+        EXPECT_EQ(alg::argeq_sorted(d, v), alg::argeq(d, v));
+        EXPECT_EQ(alg::argeq_sorted(s, v), alg::argeq(s, v));
+    }
+    EXPECT_EQ(alg::argeq_sorted(d, 1.2).first, 0);
+    EXPECT_THROW(alg::argeq_sorted(Eigen::VectorXd{}, 1.), std::runtime_error);
+}
+
+TEST(alg, histogram) {
+    constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+    Eigen::VectorXd data(8);
+    data << 0., 0.5, 1., 2.5, 4., -1., 5., nan;
+    Eigen::VectorXd weights = Eigen::VectorXd::LinSpaced(8, 1., 8.);
+    alg::UniformBins ubins{4, 0., 4.};
+    EXPECT_EQ(alg::histogram(ubins, data), Eigen::Vector4d(2, 1, 1, 1));
+    EXPECT_EQ(alg::histogram(ubins, data, weights),
+              Eigen::Vector4d(3, 3, 4, 5));
+    Eigen::VectorXd edges(3);
+    edges << 0., 1., 4.;
+    alg::EdgeBins ebins{edges};
+    EXPECT_EQ(alg::histogram(ebins, data), Eigen::Vector2d(2, 3));
+    EXPECT_EQ(ebins.index(1.), 1);
+    EXPECT_EQ(ebins.index(4.), 1);
+    EXPECT_EQ(ebins.index(4.5), -1);
+    EXPECT_THROW((alg::UniformBins{0, 0., 1.}), std::runtime_error);
+    EXPECT_THROW(alg::histogram(ubins, data, weights.head(3)),
+                 std::runtime_error);
+    // parallel
+    Eigen::VectorXd x = Eigen::VectorXd::Random(10000);
+    Eigen::VectorXd y = Eigen::VectorXd::Random(10000);
+    Eigen::VectorXd w = Eigen::VectorXd::Random(10000);
+    alg::UniformBins xbins{20, -1., 1.};
+    alg::EdgeBins ybins{Eigen::VectorXd::LinSpaced(11, -1., 1.)};
+    for (const auto &mode : {"seq", "omp"}) {
+        const auto &ex = grppiex::shared_ex(mode);
+        EXPECT_EQ(alg::histogram(ex, xbins, x), alg::histogram(xbins, x));
+        EXPECT_TRUE(alg::histogram(ex, ybins, x, w).isApprox(
+            alg::histogram(ybins, x, w)));
+        auto h2 = alg::histogram2d(ex, xbins, ybins, x, y);
+        EXPECT_EQ(h2, alg::histogram2d(xbins, ybins, x, y));
+        EXPECT_EQ(h2.rows(), 20);
+        EXPECT_EQ(h2.cols(), 10);
+        EXPECT_EQ(h2.sum(), 10000);
+        EXPECT_TRUE(alg::histogram2d(ex, xbins, ybins, x, y, w)
+                        .isApprox(alg::histogram2d(xbins, ybins, x, y, w)));
+    }
+    EXPECT_EQ(alg::histogram2d(xbins, ybins, x, y).colwise().sum().transpose(),
+              alg::histogram(ybins, y));
+    // upsample
+    Eigen::VectorXd v(2);
+    v << 2., 4.;
+    Eigen::VectorXd up(4);
+    up << 1., 1., 2., 2.;
+    EXPECT_EQ(alg::upsample(v, 2), up);
+    EXPECT_EQ(alg::upsample<false>(v, 2), (up * 2).eval());
+}
+
+TEST(alg, downsample) {
+    using alg::Axis;
+    Eigen::VectorXd v = Eigen::VectorXd::LinSpaced(11, 0., 10.);
+    for (Eigen::Index n : {1, 2, 3, 4, 5, 11, 20}) {
+        auto down = alg::downsample(v, n);
+        ASSERT_EQ(down.size(), (v.size() + n - 1) / n);
+        for (Eigen::Index i = 0; i < down.size(); ++i) {
+            auto len = std::min(n, v.size() - i * n);
+            EXPECT_DOUBLE_EQ(down.coeff(i), v.segment(i * n, len).sum());
+            EXPECT_DOUBLE_EQ(alg::downsample<false>(v, n).coeff(i),
+                             v.segment(i * n, len).mean());
+        }
+    }
+    // inverse of upsample
+    EXPECT_TRUE(alg::downsample(alg::upsample(v, 3), 3).isApprox(v));
+    // along axis
+    Eigen::MatrixXd m = Eigen::MatrixXd::Random(10, 7);
+    auto colwise = alg::downsample<false, Axis::Colwise>(m, 4);
+    EXPECT_EQ(colwise.rows(), 3);
+    EXPECT_TRUE(colwise.row(2).isApprox(m.bottomRows(2).colwise().mean()));
+    auto rowwise = alg::downsample<true, Axis::Rowwise>(m, 3);
+    EXPECT_EQ(rowwise.cols(), 3);
+    EXPECT_TRUE(rowwise.col(1).isApprox(m.middleCols(3, 3).rowwise().sum()));
+    Eigen::MatrixXd transposed = m.transpose();
+    auto rowwise_t = alg::downsample<true, Axis::Rowwise>(transposed, 4);
+    auto colwise_t = alg::downsample<true, Axis::Colwise>(m, 4);
+    EXPECT_TRUE(rowwise_t.isApprox(colwise_t.transpose()));
+    // rebin
+    Eigen::VectorXd head = v.head(10);
+    EXPECT_TRUE(alg::rebin(head, 5).isApprox(alg::downsample(head, 2)));
+    auto identity = alg::rebin<true, Axis::Rowwise>(m, 7);
+    EXPECT_TRUE(identity.isApprox(m));
+    auto rebinned = alg::rebin(v, 4);
+    EXPECT_DOUBLE_EQ(rebinned.sum(), v.sum());
+    EXPECT_DOUBLE_EQ(rebinned.coeff(0), 0. + 1. + 0.75 * 2.);
+    EXPECT_DOUBLE_EQ(alg::rebin<false>(v, 4).coeff(0), (0. + 1. + 1.5) / 2.75);
+    auto rowwise_rebinned = alg::rebin<true, Axis::Rowwise>(m, 3);
+    EXPECT_TRUE(
+        rowwise_rebinned.rowwise().sum().isApprox(m.rowwise().sum()));
+    // row vectors, strided and row-major data, and fixed-size types
+    Eigen::RowVectorXd r = v.transpose();
+    Eigen::RowVectorXd rdown = alg::downsample(r, 3);
+    EXPECT_TRUE(rdown.isApprox(alg::downsample(v, 3).transpose()));
+    EXPECT_TRUE(alg::downsample<false>(m.row(2), 3).isApprox(
+        alg::downsample<false, Axis::Rowwise>(m, 3).row(2)));
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+        rowmajor = m;
+    EXPECT_TRUE(alg::downsample(rowmajor, 4).isApprox(colwise_t));
+    EXPECT_TRUE(alg::downsample(m * 2., 4).isApprox(colwise_t * 2.));
+    Eigen::Matrix<double, 6, 1> fixed = v.head(6);
+    Eigen::VectorXd fdown = alg::downsample(fixed, 4);
+    EXPECT_TRUE(fdown.isApprox(alg::downsample(v.head(6), 4)));
+    EXPECT_TRUE(alg::rebin(fixed, 4).isApprox(alg::rebin(v.head(6), 4)));
+    EXPECT_EQ(alg::upsample(fixed, 2).size(), 12);
+    Eigen::Matrix<double, 1, 6> rfixed = fixed.transpose();
+    EXPECT_TRUE(alg::rebin(rfixed, 4).isApprox(alg::rebin(r.head(6), 4)));
+    Eigen::Matrix<double, 4, 3> mfixed = m.topLeftCorner(4, 3);
+    EXPECT_TRUE(alg::downsample(mfixed, 3).isApprox(
+        alg::downsample(Eigen::MatrixXd(mfixed), 3)));
+}
+
+TEST(alg, merge_feature_runs) {
+    using Index = alg::detect1d::Index;
+    using segments_t = std::vector<std::pair<Index, Index>>;
+    // overlapping and out of order runs
+    std::vector<std::vector<Index>> runs{
+        {5, 6, 7, 20}, {}, {0, 1, 6, 8}, {21, 22}, {30}};
+    EXPECT_EQ(alg::detect1d::merge_feature_runs(runs),
+              (segments_t{{0, 2}, {5, 9}, {20, 23}, {30, 31}}));
+    EXPECT_TRUE(alg::detect1d::merge_feature_runs(
+                    std::vector<std::vector<Index>>{})
+                    .empty());
+}
+
+TEST(alg, divconqfinder_stream) {
+    using Index = alg::detect1d::Index;
+    const Index n = 1000;
+    Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(n, 0, n - 1);
+    Eigen::VectorXd y = (x.array() * 0.05).sin();
+    auto chunkfunc = [](Index size) {
+        std::vector<std::pair<Index, Index>> chunks;
+        for (Index i = 0; i < size; i += 37) {
+            chunks.emplace_back(i, std::min(i + 37, size));
+        }
+        return chunks;
+    };
+    auto findfunc = [](const auto &xs, const auto &ys)
+        -> std::optional<std::tuple<std::vector<Index>>> {
+        std::vector<Index> index;
+        for (Index i = 0; i < ys.size(); ++i) {
+            if (ys(i) > 0.9) {
+                index.push_back(i);
+            }
+        }
+        if (index.empty() || xs.size() == 0) {
+            return std::nullopt;
+        }
+        return std::make_tuple(std::move(index));
+    };
+    auto propfunc = [](const auto &xs, const auto &)
+        -> std::optional<std::tuple<double, double>> {
+        return std::make_tuple(xs(0), xs(xs.size() - 1));
+    };
+    auto sorted = [](auto v) {
+        std::sort(v.begin(), v.end());
+        return v;
+    };
+    auto expected = sorted(alg::detect1d::divconqfinder(
+        chunkfunc, findfunc, propfunc, grppiex::Mode::seq)(x, y));
+    EXPECT_EQ(expected.size(), 8u);
+    for (Index block : {Index{1}, Index{50}, Index{333}, n}) {
+        auto stream = alg::detect1d::divconqfinder_stream(chunkfunc, findfunc,
+                                                          propfunc, 5);
+        std::vector<std::tuple<double, double>> results;
+        std::size_t n_segments = 0;
+        for (Index i = 0; i < n; i += block) {
+            auto size = std::min(block, n - i);
+            auto r = stream.push(x.segment(i, size), y.segment(i, size));
+            results.insert(results.end(), r.begin(), r.end());
+            // memory is bounded
+            EXPECT_LE(stream.carry_size(), 2 * 5 + block + 32);
+            EXPECT_LE(stream.capacity(), 2 * (2 * 5 + block + 32));
+            auto segments = stream.pop_finished();
+            EXPECT_EQ(segments.size(), r.size());
+            n_segments += segments.size();
+        }
+        auto r = stream.finish();
+        results.insert(results.end(), r.begin(), r.end());
+        EXPECT_EQ(sorted(results), expected);
+        n_segments += stream.pop_finished().size();
+        EXPECT_EQ(n_segments, expected.size());
+        EXPECT_TRUE(stream.pop_finished().empty());
+    }
+}
+
+TEST(alg, divconqfinder_stream_grow) {
+    using Index = alg::detect1d::Index;
+    using segments_t = std::vector<std::pair<Index, Index>>;
+    const Index n = 200;
+    Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(n, 0, n - 1);
+    Eigen::VectorXd y = Eigen::VectorXd::Zero(n);
+    y.segment(100, 10).setOnes();
+    y.segment(130, 10).setOnes();
+    auto chunkfunc = [](Index size) { return segments_t{{0, size}}; };
+    // look ahead 25 samples, which is more than the margin, so the
+    // first feature grows when the second one arrives
+    const Index lookahead = 25;
+    auto findfunc = [&](const auto &, const auto &ys)
+        -> std::optional<std::tuple<std::vector<Index>>> {
+        std::vector<Index> index;
+        for (Index i = 0; i < ys.size(); ++i) {
+            auto m = std::min(lookahead, ys.size() - i);
+            if (ys.segment(i, m).maxCoeff() > 0.9) {
+                index.push_back(i);
+            }
+        }
+        if (index.empty()) {
+            return std::nullopt;
+        }
+        return std::make_tuple(std::move(index));
+    };
+    auto propfunc = [](const auto &xs, const auto &)
+        -> std::optional<std::tuple<double, double>> {
+        return std::make_tuple(xs(0), xs(xs.size() - 1));
+    };
+    auto stream = alg::detect1d::divconqfinder_stream(
+        chunkfunc, findfunc, propfunc, 5, grppiex::Mode::seq);
+    // the block boundary is inside the margin after the first feature
+    auto r = stream.push(x.head(117), y.head(117));
+    EXPECT_EQ(stream.pop_finished(), (segments_t{{76, 110}}));
+    auto r1 = stream.push(x.tail(n - 117), y.tail(n - 117));
+    r.insert(r.end(), r1.begin(), r1.end());
+    auto r2 = stream.finish();
+    r.insert(r.end(), r2.begin(), r2.end());
+    // the grown feature is clipped to the samples not finished before
+    EXPECT_EQ(stream.pop_finished(), (segments_t{{112, 140}}));
+    ASSERT_EQ(r.size(), 2u);
+    EXPECT_EQ(r[0], std::make_tuple(76., 109.));
+    EXPECT_EQ(r[1], std::make_tuple(112., 139.));
+}
+
+TEST(alg, divconqfinder_batch) {
+    using Index = alg::detect1d::Index;
+    const Index n = 500;
+    Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(n, 0, n - 1);
+    Eigen::MatrixXd y(n, 4);
+    for (Index c = 0; c < y.cols(); ++c) {
+        y.col(c) = (x.array() * 0.01 * (c + 1)).sin();
+    }
+    auto chunkfunc = [](Index size) {
+        std::vector<std::pair<Index, Index>> chunks;
+        for (Index i = 0; i < size; i += 50) {
+            chunks.emplace_back(i, std::min(i + 50, size));
+        }
+        return chunks;
+    };
+    auto findfunc = [](const auto &, const auto &ys)
+        -> std::optional<std::tuple<std::vector<Index>>> {
+        std::vector<Index> index;
+        for (Index i = 0; i < ys.size(); ++i) {
+            if (ys(i) > 0.9) {
+                index.push_back(i);
+            }
+        }
+        if (index.empty()) {
+            return std::nullopt;
+        }
+        return std::make_tuple(std::move(index));
+    };
+    auto propfunc = [](const auto &xs, const auto &)
+        -> std::optional<std::tuple<double, double>> {
+        return std::make_tuple(xs(0), xs(xs.size() - 1));
+    };
+    auto results = alg::detect1d::divconqfinder_batch(chunkfunc, findfunc,
+                                                      propfunc)(x, y);
+    ASSERT_EQ(results.size(), 4u);
+    auto finder = alg::detect1d::divconqfinder(chunkfunc, findfunc, propfunc,
+                                               grppiex::Mode::seq);
+    for (Index c = 0; c < y.cols(); ++c) {
+        Eigen::VectorXd yc = y.col(c);
+        auto expected = finder(x, yc);
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(results[static_cast<std::size_t>(c)], expected);
+        EXPECT_FALSE(expected.empty());
+    }
+}
+
+TEST(alg, divconqfinder_cache) {
+    using Index = alg::detect1d::Index;
+    const Index n = 300;
+    Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(n, 0, n - 1);
+    Eigen::VectorXd y = (x.array() * 0.05).sin();
+    auto chunkfunc = [](Index size) {
+        return std::vector<std::pair<Index, Index>>{{0, size / 2},
+                                                    {size / 2, size}};
+    };
+    // the feature index is returned in descending order
+    auto findfunc = [](const auto &, const auto &ys)
+        -> std::optional<std::tuple<std::vector<Index>>> {
+        std::vector<Index> index;
+        for (Index i = ys.size() - 1; i >= 0; --i) {
+            if (ys(i) > 0.9) {
+                index.push_back(i);
+            }
+        }
+        return std::make_tuple(std::move(index));
+    };
+    // every other segment has no props
+    auto propfunc = [](const auto &xs, const auto &)
+        -> std::optional<std::tuple<double>> {
+        if (static_cast<Index>(xs(0)) % 2 == 0) {
+            return std::nullopt;
+        }
+        return std::make_tuple(xs(0));
+    };
+    auto [r0, cache0] = alg::detect1d::divconqfinder<true>(
+        chunkfunc, findfunc, propfunc)(x, y);
+    auto [r1, cache1] = alg::detect1d::divconqfinder<true, true>(
+        chunkfunc, findfunc, propfunc)(x, y);
+    EXPECT_EQ(r0, r1);
+    // the ref cache maps the input data
+    EXPECT_EQ(cache1.xdata.data(), x.data());
+    EXPECT_EQ(cache1.ydata.data(), y.data());
+    EXPECT_EQ(cache0.segmentindex, cache1.segmentindex);
+    EXPECT_EQ(cache0.findfunc_results, cache1.findfunc_results);
+    // the cached feature index is offset to the data but not sorted
+    const auto &index = std::get<0>(cache0.findfunc_results[1].value());
+    EXPECT_GE(index.front(), n / 2);
+    EXPECT_FALSE(std::is_sorted(index.begin(), index.end()));
+    // the ref cache refers to the results for the props
+    ASSERT_EQ(cache0.propfunc_results.size(), cache1.propindex.size());
+    for (std::size_t i = 0; i < cache1.propindex.size(); ++i) {
+        auto p = cache1.propindex[i];
+        EXPECT_EQ(p >= 0, cache0.propfunc_results[i].has_value());
+        if (p >= 0) {
+            EXPECT_EQ(r1[static_cast<std::size_t>(p)],
+                      cache0.propfunc_results[i].value());
+        }
+    }
+    EXPECT_LT(cache1.memory_footprint(), cache0.memory_footprint());
+}
+
 TEST(alg, fill_linspaced) {
     Eigen::MatrixXd m{5, 10};
     alg::fill_linspaced(m, 0, 98);